@@ -0,0 +1,616 @@
+/*
+ * Host capability checks for projc and the builds it generates
+ *
+ *      doctor probes the kernel and filesystem features the fast
+ *      paths in generated projects rely on and prints, per feature,
+ *      whether the fast path or its fallback will be taken. Host-wide
+ *      probes are cached; per-directory ones are cheap and always run
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doctor.h"
+
+#if (defined (_WIN32) || defined (_WIN64))
+
+int doctor_main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+    printf("doctor is not supported on Windows; the probed features are Linux only.\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/fs.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define DOCTOR_HAVE_URING_H 1
+#endif
+#endif
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+/* The uring-batch engine needs this (5.6) and falls back without it */
+#ifndef IORING_FEAT_RW_CUR_POS
+#define IORING_FEAT_RW_CUR_POS (1U << 3)
+#endif
+
+#define TMPFS_MAGIC_ 0x01021994
+
+/* Cached host probes go stale after this many seconds, or sooner
+ * when the kernel or PATH changes
+ */
+#define DOCTOR_TTL (24 * 60 * 60)
+
+/* Looked up on PATH; linkers fastest first */
+static const char *const TOOLS[] = { "mold", "ld.lld", "ld.gold", "ld.bfd", "perf" };
+
+#define NTOOLS (sizeof(TOOLS) / sizeof(TOOLS[0]))
+#define NLINKERS 4
+
+struct host {
+    char kernel[65];
+    unsigned long path_hash;
+    long long probed;
+    int uring_err;              /* 0 when io_uring_setup succeeded */
+    unsigned uring_features;
+    int uring_disabled;         /* kernel.io_uring_disabled, -1 if absent */
+    int paranoid;               /* INT_MIN if perf events are absent */
+    char thp[16];
+    char thp_defrag[16];
+    unsigned tools;             /* bit i set when TOOLS[i] is on PATH */
+};
+
+enum { CHECK_FAST, CHECK_OK, CHECK_FALLBACK };
+
+static const char *const STATUS_NAMES[] = { "fast", "ok", "fallback" };
+
+struct check {
+    const char *name;
+    int status;
+    char value[96];
+    char advice[192];
+};
+
+
+static unsigned long hash_str(const char *s) {
+    unsigned long h = 5381;
+    for (; s != NULL && *s != '\0'; s++) {
+        h = h * 33 + (unsigned char) *s;
+    }
+    return h;
+}
+
+
+static int read_line(const char *path, char *buf, size_t cap) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    if (fgets(buf, (int) cap, fp) == NULL) {
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = '\0';
+    return 1;
+}
+
+
+/* Picks the [selected] word out of a sysfs choice list */
+static void read_choice(const char *path, char *dest, size_t cap) {
+    char buf[128], *l, *r;
+    snprintf(dest, cap, "unknown");
+    if (read_line(path, buf, sizeof(buf)) && (l = strchr(buf, '[')) != NULL &&
+            (r = strchr(l, ']')) != NULL) {
+        *r = '\0';
+        snprintf(dest, cap, "%s", l + 1);
+    }
+}
+
+
+static int on_path(const char *tool) {
+    char buf[PATH_MAX];
+    const char *path = getenv("PATH"), *p, *end;
+
+    for (p = path; p != NULL && *p != '\0'; p = *end ? end + 1 : end) {
+        size_t len;
+        end = strchr(p, ':');
+        end = end ? end : p + strlen(p);
+        len = (size_t) (end - p);
+        if (len == 0 || len + strlen(tool) + 2 > sizeof(buf)) {
+            continue;
+        }
+        memcpy(buf, p, len);
+        buf[len] = '/';
+        strcpy(buf + len + 1, tool);
+        if (access(buf, X_OK) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static void probe_uring(struct host *h) {
+    char buf[32];
+
+    h->uring_disabled = read_line("/proc/sys/kernel/io_uring_disabled", buf, sizeof(buf))
+                        ? atoi(buf) : -1;
+#if defined(DOCTOR_HAVE_URING_H) && defined(__NR_io_uring_setup)
+    {
+        struct io_uring_params p;
+        long fd;
+        memset(&p, 0, sizeof(p));
+        fd = syscall(__NR_io_uring_setup, 1, &p);
+        if (fd >= 0) {
+            close((int) fd);
+            h->uring_err = 0;
+            h->uring_features = p.features;
+        } else {
+            h->uring_err = errno;
+        }
+    }
+#else
+    h->uring_err = ENOSYS;
+#endif
+}
+
+
+static void probe_host(struct host *h, const char *kernel, unsigned long path_hash) {
+    char buf[32];
+
+    memset(h, 0, sizeof(*h));
+    snprintf(h->kernel, sizeof(h->kernel), "%s", kernel);
+    h->path_hash = path_hash;
+    h->probed = (long long) time(NULL);
+    probe_uring(h);
+    h->paranoid = read_line("/proc/sys/kernel/perf_event_paranoid", buf, sizeof(buf))
+                  ? atoi(buf) : INT_MIN;
+    read_choice("/sys/kernel/mm/transparent_hugepage/enabled", h->thp, sizeof(h->thp));
+    read_choice("/sys/kernel/mm/transparent_hugepage/defrag", h->thp_defrag,
+                sizeof(h->thp_defrag));
+    for (size_t i = 0; i < NTOOLS; i++) {
+        if (on_path(TOOLS[i]) || (i == 0 && on_path("ld.mold"))) {
+            h->tools |= 1u << i;
+        }
+    }
+}
+
+
+static int cache_path(char *dest, size_t cap, int create) {
+    const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    char dir[PATH_MAX];
+
+    if (xdg != NULL && xdg[0] == '/') {
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    } else if (home != NULL && home[0] != '\0') {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    } else {
+        return 0;
+    }
+    if (create) {
+        mkdir(dir, 0755);
+    }
+    if (strlen(dir) + sizeof("/projc/doctor.cache") > cap) {
+        return 0;
+    }
+    strcat(dir, "/projc");
+    if (create) {
+        mkdir(dir, 0755);
+    }
+    snprintf(dest, cap, "%s/doctor.cache", dir);
+    return 1;
+}
+
+
+/* One "key value" pair per line; anything missing discards the cache */
+static int cache_load(struct host *h) {
+    char path[PATH_MAX], line[128], key[32], val[72];
+    unsigned fields = 0;
+    FILE *fp;
+
+    if (!cache_path(path, sizeof(path), 0) || (fp = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+    memset(h, 0, sizeof(*h));
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "%31s %71s", key, val) != 2) {
+            continue;
+        }
+        if (strcmp(key, "kernel") == 0) {
+            fields |= 1u << 0;
+            snprintf(h->kernel, sizeof(h->kernel), "%.64s", val);
+        } else if (strcmp(key, "path_hash") == 0) {
+            fields |= (unsigned) (sscanf(val, "%lu", &h->path_hash) == 1) << 1;
+        } else if (strcmp(key, "probed") == 0) {
+            fields |= (unsigned) (sscanf(val, "%lld", &h->probed) == 1) << 2;
+        } else if (strcmp(key, "uring_err") == 0) {
+            fields |= (unsigned) (sscanf(val, "%d", &h->uring_err) == 1) << 3;
+        } else if (strcmp(key, "uring_features") == 0) {
+            fields |= (unsigned) (sscanf(val, "%x", &h->uring_features) == 1) << 4;
+        } else if (strcmp(key, "uring_disabled") == 0) {
+            fields |= (unsigned) (sscanf(val, "%d", &h->uring_disabled) == 1) << 5;
+        } else if (strcmp(key, "paranoid") == 0) {
+            fields |= (unsigned) (sscanf(val, "%d", &h->paranoid) == 1) << 6;
+        } else if (strcmp(key, "thp") == 0) {
+            fields |= 1u << 7;
+            snprintf(h->thp, sizeof(h->thp), "%.15s", val);
+        } else if (strcmp(key, "thp_defrag") == 0) {
+            fields |= 1u << 8;
+            snprintf(h->thp_defrag, sizeof(h->thp_defrag), "%.15s", val);
+        } else if (strcmp(key, "tools") == 0) {
+            fields |= (unsigned) (sscanf(val, "%x", &h->tools) == 1) << 9;
+        }
+    }
+    fclose(fp);
+    return fields == (1u << 10) - 1;
+}
+
+
+static void cache_store(const struct host *h) {
+    char path[PATH_MAX], tmp[PATH_MAX + 16];
+    FILE *fp;
+
+    if (!cache_path(path, sizeof(path), 1)) {
+        return;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long) getpid());
+    if ((fp = fopen(tmp, "w")) == NULL) {
+        return;
+    }
+    fprintf(fp, "kernel %s\npath_hash %lu\nprobed %lld\nuring_err %d\n"
+            "uring_features %x\nuring_disabled %d\nparanoid %d\nthp %s\n"
+            "thp_defrag %s\ntools %x\n",
+            h->kernel, h->path_hash, h->probed, h->uring_err, h->uring_features,
+            h->uring_disabled, h->paranoid, h->thp, h->thp_defrag, h->tools);
+    if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+
+static const char *fs_name(long type) {
+    static const struct { long magic; const char *name; } FS[] = {
+        { TMPFS_MAGIC_, "tmpfs" }, { 0x858458f6, "ramfs" }, { 0xEF53, "ext4" },
+        { 0x58465342, "xfs" }, { 0x9123683E, "btrfs" }, { 0xCA451A4E, "bcachefs" },
+        { 0x2FC12FC1, "zfs" }, { 0xF2F52010, "f2fs" }, { 0x794c7630, "overlayfs" },
+        { 0x6969, "nfs" }, { 0xFF534D42, "cifs" }, { 0x65735546, "fuse" },
+        { 0x4d44, "vfat" },
+    };
+    for (size_t i = 0; i < sizeof(FS) / sizeof(FS[0]); i++) {
+        if ((unsigned long) FS[i].magic == (unsigned long) type) {
+            return FS[i].name;
+        }
+    }
+    return "other";
+}
+
+
+static int is_tmpfs(const char *dir) {
+    struct statfs sf;
+    return dir != NULL && statfs(dir, &sf) == 0 &&
+           ((unsigned long) sf.f_type == TMPFS_MAGIC_ ||
+            (unsigned long) sf.f_type == 0x858458f6UL);
+}
+
+
+/* Clones one block between two scratch files in dir; 0 on success */
+static int probe_reflink(const char *dir) {
+    char a[PATH_MAX], b[PATH_MAX], block[4096];
+    int src, dst, err = 0;
+
+    if (snprintf(a, sizeof(a), "%s/.projc-doctor-XXXXXX", dir) >= (int) sizeof(a)) {
+        return ENAMETOOLONG;
+    }
+    strcpy(b, a);
+    if ((src = mkstemp(a)) < 0) {
+        return errno;
+    }
+    if ((dst = mkstemp(b)) < 0) {
+        err = errno;
+        close(src);
+        unlink(a);
+        return err;
+    }
+    memset(block, 0x5a, sizeof(block));
+    if (write(src, block, sizeof(block)) != (ssize_t) sizeof(block) || fsync(src) != 0) {
+        err = EIO;
+    } else if (ioctl(dst, FICLONE, src) != 0) {
+        err = errno;
+    }
+    close(src);
+    close(dst);
+    unlink(a);
+    unlink(b);
+    return err;
+}
+
+
+static void check_uring(const struct host *h, struct check *c) {
+    c->name = "io_uring";
+    if (h->uring_err == 0 && (h->uring_features & IORING_FEAT_RW_CUR_POS)) {
+        c->status = CHECK_FAST;
+        snprintf(c->value, sizeof(c->value), "available (features 0x%x)", h->uring_features);
+        snprintf(c->advice, sizeof(c->advice),
+                 "--archetype uring-batch runs its io_uring engine");
+        return;
+    }
+    c->status = CHECK_FALLBACK;
+    if (h->uring_err == 0) {
+        snprintf(c->value, sizeof(c->value), "too old (features 0x%x, no RW_CUR_POS)",
+                 h->uring_features);
+    } else if (h->uring_err == ENOSYS) {
+        snprintf(c->value, sizeof(c->value), "not in this kernel");
+    } else if (h->uring_err == EPERM && h->uring_disabled > 0) {
+        snprintf(c->value, sizeof(c->value), "disabled (kernel.io_uring_disabled=%d)",
+                 h->uring_disabled);
+    } else if (h->uring_err == EPERM) {
+        snprintf(c->value, sizeof(c->value), "blocked (seccomp or LSM)");
+    } else {
+        snprintf(c->value, sizeof(c->value), "setup failed: %s", strerror(h->uring_err));
+    }
+    snprintf(c->advice, sizeof(c->advice),
+             "--archetype uring-batch falls back to its threaded pread loop");
+}
+
+
+static void check_reflink(const char *dir, const char *fs, struct check *c) {
+    int err = probe_reflink(dir);
+    c->name = "reflink";
+    if (err == 0) {
+        c->status = CHECK_FAST;
+        snprintf(c->value, sizeof(c->value), "supported (%s)", fs);
+        snprintf(c->advice, sizeof(c->advice),
+                 "cp --reflink=auto of projects and build trees shares extents");
+        return;
+    }
+    c->status = CHECK_FALLBACK;
+    if (err == EOPNOTSUPP || err == EINVAL || err == ENOTTY || err == EXDEV) {
+        snprintf(c->value, sizeof(c->value), "not supported (%s)", fs);
+    } else {
+        snprintf(c->value, sizeof(c->value), "unknown (%s)", strerror(err));
+    }
+    snprintf(c->advice, sizeof(c->advice),
+             "copies of projects and build trees copy every byte; btrfs, xfs or"
+             " bcachefs clone instead");
+}
+
+
+static void check_tmpfs(const char *fs, struct check *c) {
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    const char *alt = is_tmpfs("/dev/shm") ? "/dev/shm" : is_tmpfs(runtime) ? runtime : NULL;
+
+    c->name = "build tmpfs";
+    if (strcmp(fs, "tmpfs") == 0 || strcmp(fs, "ramfs") == 0) {
+        c->status = CHECK_FAST;
+        snprintf(c->value, sizeof(c->value), "yes (%s)", fs);
+        snprintf(c->advice, sizeof(c->advice),
+                 "obj/ and build/ are written to memory");
+        return;
+    }
+    c->status = CHECK_FALLBACK;
+    snprintf(c->value, sizeof(c->value), "no (%s)", fs);
+    if (alt != NULL) {
+        snprintf(c->advice, sizeof(c->advice),
+                 "build/ hits the disk; ln -s %.100s/NAME-build build keeps it in memory",
+                 alt);
+    } else {
+        snprintf(c->advice, sizeof(c->advice),
+                 "build/ hits the disk and no tmpfs was found to move it to");
+    }
+}
+
+
+static void check_perf(const struct host *h, struct check *c) {
+    int have_perf = (h->tools >> (NTOOLS - 1)) & 1;
+    c->name = "perf events";
+    if (h->paranoid == INT_MIN) {
+        c->status = CHECK_FALLBACK;
+        snprintf(c->value, sizeof(c->value), "not available");
+        snprintf(c->advice, sizeof(c->advice),
+                 "no perf profiling; make memprof and --with lockprof do not need it");
+        return;
+    }
+    if (h->paranoid <= 1) {
+        c->status = have_perf ? CHECK_FAST : CHECK_OK;
+        snprintf(c->value, sizeof(c->value), "paranoid=%d%s", h->paranoid,
+                 have_perf ? "" : ", perf not on PATH");
+        snprintf(c->advice, sizeof(c->advice),
+                 "perf record sees user and kernel stacks of build/ binaries");
+    } else if (h->paranoid == 2) {
+        c->status = CHECK_OK;
+        snprintf(c->value, sizeof(c->value), "paranoid=2%s", have_perf ? "" : ", perf not on PATH");
+        snprintf(c->advice, sizeof(c->advice),
+                 "perf record works on own processes, user space only;"
+                 " sysctl kernel.perf_event_paranoid=1 adds kernel samples");
+    } else {
+        c->status = CHECK_FALLBACK;
+        snprintf(c->value, sizeof(c->value), "paranoid=%d", h->paranoid);
+        snprintf(c->advice, sizeof(c->advice),
+                 "perf needs root here; make memprof and --with lockprof do not");
+    }
+}
+
+
+static void check_thp(const struct host *h, struct check *c) {
+    c->name = "THP";
+    snprintf(c->value, sizeof(c->value), "%s (defrag %s)", h->thp, h->thp_defrag);
+    if (strcmp(h->thp, "always") == 0) {
+        c->status = CHECK_OK;
+        snprintf(c->advice, sizeof(c->advice),
+                 "large heaps get huge pages; khugepaged can shift make bench results");
+    } else if (strcmp(h->thp, "madvise") == 0) {
+        c->status = CHECK_OK;
+        snprintf(c->advice, sizeof(c->advice),
+                 "huge pages only where madvise(MADV_HUGEPAGE) asks; stable for make bench");
+    } else {
+        c->status = CHECK_FALLBACK;
+        snprintf(c->advice, sizeof(c->advice),
+                 "no huge pages; large working sets pay for 4KiB TLB entries");
+    }
+}
+
+
+static void check_linker(const struct host *h, struct check *c) {
+    size_t n = 0, best = NLINKERS;
+    c->name = "linker";
+    c->value[0] = '\0';
+    for (size_t i = 0; i < NLINKERS; i++) {
+        if (h->tools & (1u << i)) {
+            n += (size_t) snprintf(c->value + n, sizeof(c->value) - n, "%s%s",
+                                   n ? " " : "", TOOLS[i]);
+            best = best == NLINKERS ? i : best;
+        }
+    }
+    if (best < 2) {
+        const char *flag = best == 0 ? "mold" : "lld";
+        c->status = CHECK_FAST;
+        snprintf(c->advice, sizeof(c->advice),
+                 "link with make CC='gcc -fuse-ld=%s' (and LIBS=-fuse-ld=%s for the"
+                 " main target)", flag, flag);
+    } else {
+        c->status = best == NLINKERS ? CHECK_FALLBACK : CHECK_OK;
+        if (best == NLINKERS) {
+            snprintf(c->value, sizeof(c->value), "none of mold, lld, gold, bfd on PATH");
+        }
+        snprintf(c->advice, sizeof(c->advice),
+                 "%s; installing mold or lld makes relinking much faster",
+                 best == 2 ? "gold is usable with -fuse-ld=gold" : "default ld.bfd");
+    }
+}
+
+
+static void json_str(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(fp, "\\%c", *s);
+        } else if ((unsigned char) *s < 0x20) {
+            fprintf(fp, "\\u%04x", *s);
+        } else {
+            fputc(*s, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+
+int doctor_main(int argc, char *argv[]) {
+    const char *dir = ".";
+    int json = 0, refresh = 0, cached;
+    unsigned long path_hash = hash_str(getenv("PATH"));
+    struct utsname un;
+    struct statfs sf;
+    struct host h;
+    struct check checks[6];
+    char real[PATH_MAX];
+    const char *fs;
+    long long age;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--refresh") == 0) {
+            refresh = 1;
+        } else if (argv[i][0] != '-') {
+            dir = argv[i];
+        } else {
+            printf("usage: projc doctor [DIR] [--json] [--refresh]\n");
+            return 1;
+        }
+    }
+    if (realpath(dir, real) == NULL || statfs(real, &sf) != 0) {
+        printf("Cannot inspect %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    fs = fs_name((long) sf.f_type);
+    if (uname(&un) != 0) {
+        strcpy(un.release, "unknown");
+    }
+
+    cached = !refresh && cache_load(&h) && strcmp(h.kernel, un.release) == 0 &&
+             h.path_hash == path_hash && (long long) time(NULL) - h.probed < DOCTOR_TTL;
+    if (!cached) {
+        probe_host(&h, un.release, path_hash);
+        cache_store(&h);
+    }
+    age = (long long) time(NULL) - h.probed;
+
+    check_uring(&h, &checks[0]);
+    check_reflink(real, fs, &checks[1]);
+    check_tmpfs(fs, &checks[2]);
+    check_perf(&h, &checks[3]);
+    check_thp(&h, &checks[4]);
+    check_linker(&h, &checks[5]);
+
+    if (json) {
+        printf("{\n  \"dir\": ");
+        json_str(stdout, real);
+        printf(",\n  \"kernel\": ");
+        json_str(stdout, un.release);
+        printf(",\n  \"filesystem\": \"%s\",\n  \"cached\": %s,\n  \"age_s\": %lld,\n"
+               "  \"checks\": [", fs, cached ? "true" : "false", age);
+        for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+            printf("%s\n    { \"name\": ", i ? "," : "");
+            json_str(stdout, checks[i].name);
+            printf(", \"status\": \"%s\", \"value\": ", STATUS_NAMES[checks[i].status]);
+            json_str(stdout, checks[i].value);
+            printf(", \"advice\": ");
+            json_str(stdout, checks[i].advice);
+            printf(" }");
+        }
+        printf("\n  ]\n}\n");
+        return 0;
+    }
+
+    printf("projc doctor: %s (%s, kernel %s)\n", real, fs, un.release);
+    if (cached) {
+        printf("host checks cached %lldm ago; --refresh to probe again\n", age / 60);
+    }
+    printf("\n");
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        printf("  %-12s %-9s %s\n  %-12s %-9s %s\n", checks[i].name,
+               STATUS_NAMES[checks[i].status], checks[i].value, "", "", checks[i].advice);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host capability checks for projc and the builds it generates
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ */
+
+#ifndef PROJC_DOCTOR_H
+#define PROJC_DOCTOR_H
+
+/* projc doctor [DIR] [--json] [--refresh]
+ *      Probes io_uring, reflink, tmpfs, perf_event_paranoid, THP and
+ *      the linkers on PATH, and says which options are fast here
+ */
+int doctor_main(int argc, char *argv[]);
+
+#endif
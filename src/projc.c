@@ -32,6 +32,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <ctype.h>
+
+#include "tmpl_uring.h"
+#include "tmpl_memprof.h"
+#include "tmpl_lockprof.h"
+#include "tmpl_metrics.h"
+#include "tmpl_bench.h"
+#include "tmpl_startup.h"
+#include "report.h"
+#include "doctor.h"
+#include "workspace.h"
 
 /* All of the constant arrays are rounded up to the nearest
  * byte to fit into a page better
@@ -65,6 +76,90 @@ static const char GCC_MAKE_PHONY[128] = ": $(OBJ)\n\
 .PHONY: clean\n\n\
 clean:";
 
+/* A generated file: lands in dir as Project<suffix> */
+struct tmpl_file {
+    const char *dir;
+    const char *suffix;
+    const char *body;
+};
+
+/* Project shapes selectable with --archetype; files listed here
+ * replace the default stubs, make is appended to the Makefile
+ */
+struct archetype {
+    const char *name;
+    const char *dirs[4];
+    struct tmpl_file files[5];
+    const char *make;
+};
+
+static const struct archetype ARCHETYPES[] = {
+    { "uring-batch", { NULL },
+      { { "lib", ".h", URING_LIB_H },
+        { "lib", ".c", URING_LIB_C },
+        { "src", "_app.c", URING_APP_C },
+        { "bench", "_bench.c", URING_BENCH_C },
+        { "test", "_test.c", URING_TEST_C } },
+      URING_MAKE },
+};
+
+/* Optional pieces added with --with; they can be combined with each
+ * other and with any archetype, their make fragment comes first so
+ * archetype rules see COMPONENT_SRC and COMPONENT_CFLAGS
+ */
+struct component {
+    const char *name;
+    struct tmpl_file files[4];
+    const char *make;
+};
+
+static const struct component COMPONENTS[] = {
+    { "lockprof",
+      { { "lib", "_lockprof.h", LOCKPROF_H },
+        { "lib", "_lockprof.c", LOCKPROF_C } },
+      LOCKPROF_MAKE },
+    { "metrics",
+      { { "lib", "_metrics.h", METRICS_H },
+        { "lib", "_metrics.c", METRICS_C } },
+      METRICS_MAKE },
+};
+
+#define NCOMPONENTS (sizeof(COMPONENTS) / sizeof(COMPONENTS[0]))
+
+/* Tooling generated into every project, whatever the archetype */
+static const struct tmpl_file TOOL_FILES[] = {
+    { "tools", "_memprof.c", MEMPROF_C },
+    { "bench", "_benchenv.h", BENCHENV_H },
+    { "bench", "_benchenv.c", BENCHENV_C },
+    { "bench", "_bench.c", BENCH_C },
+    { "tools", "_startup.c", STARTUP_C },
+};
+
+/* src/Project_app.c unless the archetype has its own; the tool
+ * targets link it, so it needs a main
+ */
+static const struct tmpl_file APP_STUB = { "src", "_app.c", "\
+#include \"@PROJECT@.h\"\n\
+\n\
+int main(int argc, char *argv[]) {\n\
+    (void) argc;\n\
+    (void) argv;\n\
+    /* Code goes here */\n\
+    return 0;\n\
+}\n" };
+
+static const char *const TOOL_MAKES[] = {
+    MEMPROF_MAKE,
+    BENCH_MAKE,
+    STARTUP_MAKE,
+};
+
+struct options {
+    const struct archetype *archetype;
+    unsigned with;      /* bit i set selects COMPONENTS[i] */
+    int shard_depth;    /* hash-prefix levels above the project, 0 for none */
+};
+
 
 /* Disable security warnings for string functions */
 #ifdef _MSC_VER
@@ -156,21 +251,40 @@ static char *strslice(char *dest, const char *str, const char *spr) {
 }
 
 
-static char *strupper(char *dest, const char *str) {
-    for (int i = 0; i < strlen(str); i++) {
-        if (0x60 < (unsigned char) str[i] < 0x7b) {
-            dest[i] = (unsigned char) str[i] - (unsigned char) 0x20;
+/* Upper-cased C identifier form of the project, for header guards */
+static char *identupper(char *dest, const char *str) {
+    size_t i;
+    for (i = 0; str[i] != '\0'; i++) {
+        dest[i] = isalnum((unsigned char) str[i])
+            ? (char) toupper((unsigned char) str[i]) : '_';
+    }
+    dest[i] = '\0';
+    return dest;
+}
+
+
+/* Copies a template to fp, expanding @PROJECT@ and @GUARD@ */
+static void tmpl_expand(FILE *fp, const char *body, const char *project) {
+    char guard[PATH_MAX];
+    identupper(guard, project);
+    while (*body != '\0') {
+        if (strncmp(body, "@PROJECT@", 9) == 0) {
+            fputs(project, fp);
+            body += 9;
+        } else if (strncmp(body, "@GUARD@", 7) == 0) {
+            fputs(guard, fp);
+            body += 7;
         } else {
-            dest[i] = str[i];
+            fputc(*body++, fp);
         }
     }
-    return dest;
 }
 
 
 /* 1 indicates failure to create and 0 indicates success
  * Syntatically correct: !makefile_create = makefile not created */
-static int makefile_create(const char *makename, const char *project, const char *dirname) {
+static int makefile_create(const char *makename, const char *project, const char *dirname,
+                           const struct options *opts) {
     char make[PATH_MAX];
     char make_contents[432];
     int ret = 1;
@@ -185,6 +299,20 @@ static int makefile_create(const char *makename, const char *project, const char
                     project, GCC_MAKE_OBJ, project, 
                     GCC_MAKE_OBJ_BUILD, project, GCC_MAKE_PHONY);
             fprintf(mkfile, "%s", make_contents);
+            /* Archetype and tool targets are gcc/make only */
+            if (strcmp(makename, "Makefile") == 0) {
+                for (size_t i = 0; i < NCOMPONENTS; i++) {
+                    if (opts->with & (1u << i)) {
+                        tmpl_expand(mkfile, COMPONENTS[i].make, project);
+                    }
+                }
+                if (opts->archetype != NULL) {
+                    tmpl_expand(mkfile, opts->archetype->make, project);
+                }
+                for (size_t i = 0; i < sizeof(TOOL_MAKES) / sizeof(TOOL_MAKES[0]); i++) {
+                    tmpl_expand(mkfile, TOOL_MAKES[i], project);
+                }
+            }
         }
 
         fclose(mkfile);
@@ -210,7 +338,7 @@ static int touch(const char *path, const char *project, const char *ext) {
         } else {
             if (ext == ".h") {
                 char tmp[PATH_MAX]; /* length of project limited by PATH by default */
-                strupper(tmp, project);
+                identupper(tmp, project);
                 fprintf(fp,
                     "#ifndef %s_H\n#define %s_H\n/* Code goes here */\n\n#endif",
                     tmp, tmp);
@@ -241,6 +369,91 @@ static void touch_wrap(const char *path, const char *name, const char *dir, cons
 }
 
 
+/* Same contract as touch, but the contents come from a template */
+static int tmpl_write(const char *path, const char *project, const struct tmpl_file *tf) {
+    char fullpath[PATH_MAX];
+    int ret = 1;
+    if (strlen(path) + strlen(project) + strlen(tf->suffix) + 1 >= PATH_MAX) {
+        ret = 0;
+    } else {
+        sprintf(fullpath, "%s%c%s%s", path, sep, project, tf->suffix);
+    }
+
+    if (ret && !exists(fullpath)) {
+        FILE *fp = fopen(fullpath, "w");
+        if (fp == NULL) {
+            ret = 0;
+        } else {
+            tmpl_expand(fp, tf->body, project);
+            fclose(fp);
+        }
+    } else {
+        ret = 0;
+    }
+    return ret;
+}
+
+
+static void tmpl_wrap(const char *dirname, const char *project, const struct tmpl_file *tf) {
+    char path[PATH_MAX];
+    sprintf(path, "%s%c%s", dirname, sep, tf->dir);
+    printf("Creating file %s%s in %s directory...\n", project, tf->suffix, tf->dir);
+    if (!tmpl_write(path, project, tf)) {
+        printf("Failed to create %s%s in %s\n", project, tf->suffix, tf->dir);
+    } else {
+        printf("%s%s created in %s\n", project, tf->suffix, tf->dir);
+    }
+}
+
+
+/* Whether the archetype supplies its own dir/Project<suffix> */
+static int archetype_has(const struct archetype *arch, const char *dir, const char *suffix) {
+    if (arch == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < 5 && arch->files[i].dir != NULL; i++) {
+        if (strcmp(arch->files[i].dir, dir) == 0 &&
+                strcmp(arch->files[i].suffix, suffix) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static const struct archetype *archetype_find(const char *name) {
+    for (size_t i = 0; i < sizeof(ARCHETYPES) / sizeof(ARCHETYPES[0]); i++) {
+        if (strcmp(ARCHETYPES[i].name, name) == 0) {
+            return &ARCHETYPES[i];
+        }
+    }
+    return NULL;
+}
+
+
+/* Selects the components in a comma separated list; 0 on an unknown name */
+static int component_select(struct options *opts, const char *list) {
+    char names[256];
+    char *name;
+    strncpy(names, list, sizeof(names) - 1);
+    names[sizeof(names) - 1] = '\0';
+    for (name = strtok(names, ","); name != NULL; name = strtok(NULL, ",")) {
+        size_t i;
+        for (i = 0; i < NCOMPONENTS; i++) {
+            if (strcmp(COMPONENTS[i].name, name) == 0) {
+                opts->with |= 1u << i;
+                break;
+            }
+        }
+        if (i == NCOMPONENTS) {
+            printf("Unknown component %s\n", name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
 static int create_dir(const char *dirname, const char *destname) {
     int ret = 1;
     if (strlen(dirname) + strlen(destname) > PATH_MAX) {
@@ -259,26 +472,56 @@ static int create_dir(const char *dirname, const char *destname) {
 }
 
 
-static void create_files(const char *dirname, const char *project) {
+static void create_files(const char *dirname, const char *project, const struct options *opts) {
     const char *file_ext[2] = { ".h", ".c" };
     const char *dirs[3] = {"lib", "src", "test"};
+    const struct archetype *arch = opts->archetype;
     char tmp[PATH_MAX];
+
+    if (arch != NULL) {
+        for (int i = 0; i < 5 && arch->files[i].dir != NULL; i++) {
+            tmpl_wrap(dirname, project, &arch->files[i]);
+        }
+    }
+    for (size_t i = 0; i < NCOMPONENTS; i++) {
+        if (!(opts->with & (1u << i))) {
+            continue;
+        }
+        for (int j = 0; j < 4 && COMPONENTS[i].files[j].dir != NULL; j++) {
+            tmpl_wrap(dirname, project, &COMPONENTS[i].files[j]);
+        }
+    }
+    for (size_t i = 0; i < sizeof(TOOL_FILES) / sizeof(TOOL_FILES[0]); i++) {
+        if (!archetype_has(arch, TOOL_FILES[i].dir, TOOL_FILES[i].suffix)) {
+            tmpl_wrap(dirname, project, &TOOL_FILES[i]);
+        }
+    }
+
     sprintf(tmp, "%s%c%s", dirname, sep, dirs[0]);
-    touch_wrap(tmp, project, dirs[0], file_ext[0]);
+    if (!archetype_has(arch, dirs[0], file_ext[0])) {
+        touch_wrap(tmp, project, dirs[0], file_ext[0]);
+    }
     for (int i = 0; i < 3; i++) {
         strclr(tmp, strlen(dirname) + 1,  strlen(tmp));
         strcat(tmp, dirs[i]);
         switch (i) {
             char tmp2[PATH_MAX];
             case 1:
-                strcpy(tmp2, project);
-                touch_wrap(tmp, strcat(tmp2, "_app"), dirs[i], file_ext[1]);
+                if (!archetype_has(arch, dirs[i], APP_STUB.suffix)) {
+                    tmpl_wrap(dirname, project, &APP_STUB);
+                }
                 break;
             case 2:
+                if (archetype_has(arch, dirs[i], "_test.c")) {
+                    break;
+                }
                 strcpy(tmp2, project);
                 touch_wrap(tmp, strcat(tmp2, "_test"), dirs[i], file_ext[1]);
                 break;
             default:
+                if (archetype_has(arch, dirs[i], file_ext[1])) {
+                    break;
+                }
                 touch_wrap(tmp, project, dirs[i], file_ext[1]);
                 break;
         }
@@ -286,12 +529,12 @@ static void create_files(const char *dirname, const char *project) {
 }
 
 
-static void create_makes(const char *dirname, const char *project) {
+static void create_makes(const char *dirname, const char *project, const struct options *opts) {
     const char *mks[2] = {"Makefile", "Makefile.win"};
 
     for (int i = 0; i < 2; i++) {
         printf("Creating %s...", mks[i]);
-        if (!makefile_create(mks[i], project, dirname)) {
+        if (!makefile_create(mks[i], project, dirname, opts)) {
             printf("Failed to create %s; %s may already exist.",
                    mks[i], mks[i]);
         } else {
@@ -301,10 +544,67 @@ static void create_makes(const char *dirname, const char *project) {
 }
 
 
-static void create_tree(char *dirname) {
-    const char *dirs[4] = {"lib", "src", "test", "include"};
+/* FNV-1a over the name with a murmur3 finalizer, so similar names
+ * still spread over the top-level shards; the result must not depend
+ * on the platform
+ */
+static unsigned long shard_hash(const char *name) {
+    unsigned long h = 2166136261UL;
+    for (; *name != '\0'; name++) {
+        h = ((h ^ (unsigned char) *name) * 16777619UL) & 0xffffffffUL;
+    }
+    h ^= h >> 16;
+    h = (h * 0x85ebca6bUL) & 0xffffffffUL;
+    h ^= h >> 13;
+    h = (h * 0xc2b2ae35UL) & 0xffffffffUL;
+    h ^= h >> 16;
+    return h;
+}
+
+
+/* Builds root/ab/cd/name for depth 2, creating every level; rel gets
+ * the '/' separated path below root for the index. Returns 1 if the
+ * project directory is new, 0 if it existed and -1 on failure
+ */
+static int shard_dir(char *dirname, char *rel, const char *root, const char *name, int depth) {
+    unsigned long h = shard_hash(name);
+    size_t rootlen = strlen(root);
+    int existed;
 
-    for (int i = 0; i < 4; i++) {
+    if (rootlen + 3 * depth + strlen(name) + 2 >= PATH_MAX) {
+        return -1;
+    }
+    strcpy(dirname, root);
+    rel[0] = '\0';
+    for (int i = 0; i < depth; i++) {
+        char level[3];
+        sprintf(level, "%02lx", (h >> (24 - 8 * i)) & 0xff);
+        sprintf(dirname + strlen(dirname), "%c%s", sep, level);
+        sprintf(rel + strlen(rel), "%s/", level);
+        mk_dir(dirname);
+    }
+    sprintf(dirname + strlen(dirname), "%c%s", sep, name);
+    strcat(rel, name);
+    existed = exists(dirname);
+    mk_dir(dirname);
+    if (!exists(dirname)) {
+        return -1;
+    }
+    return !existed;
+}
+
+
+static void create_tree(char *dirname, const struct options *opts) {
+    const char *dirs[8] = {"lib", "src", "test", "include", "tools", "bench"};
+    int ndirs = 6;
+
+    if (opts->archetype != NULL) {
+        for (int i = 0; i < 4 && opts->archetype->dirs[i] != NULL; i++) {
+            dirs[ndirs++] = opts->archetype->dirs[i];
+        }
+    }
+
+    for (int i = 0; i < ndirs; i++) {
         char tmp[256] = "Creating ";
         sprintf(tmp, "%s directory...", dirs[i]);
         puts(tmp);
@@ -321,29 +621,127 @@ static void create_tree(char *dirname) {
 }
 
 
+/* Value of a long option given as --opt=value or --opt value */
+static const char *opt_value(int argc, char *argv[], int *i, const char *opt) {
+    size_t len = strlen(opt);
+    if (strncmp(argv[*i], opt, len) != 0) {
+        return NULL;
+    }
+    if (argv[*i][len] == '=') {
+        return argv[*i] + len + 1;
+    }
+    if (argv[*i][len] == '\0' && *i + 1 < argc) {
+        return argv[++*i];
+    }
+    return NULL;
+}
+
+
 int main(int argc, char *argv[]) {
     char dirname[PATH_MAX];
     char project[PATH_MAX];
+    char root[PATH_MAX];
+    char rel[PATH_MAX];
+    struct options opts = {0};
+    const char *name = NULL;
+    const char *val;
+
+    if (argc >= 2 && strcmp(argv[1], "bench-report") == 0) {
+        return bench_report_main(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && strcmp(argv[1], "doctor") == 0) {
+        return doctor_main(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && strcmp(argv[1], "locate") == 0) {
+        return locate_main(argc - 1, argv + 1);
+    }
+    if (argc >= 2 && strcmp(argv[1], "list") == 0) {
+        return list_main(argc - 1, argv + 1);
+    }
 
-    if (argc == 2) {
-        abspath(dirname, argv[1]);
-        strcpy(project, argv[1]);
+    for (int i = 1; i < argc; i++) {
+        if ((val = opt_value(argc, argv, &i, "--archetype")) != NULL) {
+            opts.archetype = archetype_find(val);
+            if (opts.archetype == NULL) {
+                printf("Unknown archetype %s\n", val);
+                goto ERRORQUIT;
+            }
+        } else if ((val = opt_value(argc, argv, &i, "--with")) != NULL) {
+            if (!component_select(&opts, val)) {
+                goto ERRORQUIT;
+            }
+        } else if ((val = opt_value(argc, argv, &i, "--shard-depth")) != NULL) {
+            char *end;
+            long depth = strtol(val, &end, 10);
+            opts.shard_depth = *val != '\0' && *end == '\0' && depth >= 1 && depth <= 4
+                               ? (int) depth : 0;
+            if (opts.shard_depth == 0) {
+                printf("--shard-depth takes 1 to 4 levels\n");
+                goto ERRORQUIT;
+            }
+        } else if (argv[i][0] == '-' || name != NULL) {
+            goto ERRORQUIT;
+        } else {
+            name = argv[i];
+        }
+    }
+
+    if (opts.shard_depth > 0) {
+        if (name == NULL || *name == '\0' || strcmp(name, ".") == 0 ||
+                strcmp(name, "..") == 0 || strchr(name, '/') != NULL ||
+                strchr(name, '\\') != NULL) {
+            printf("--shard-depth needs a plain project name\n");
+            goto ERRORQUIT;
+        }
+        abspath(root, ".");
+        if (shard_dir(dirname, rel, root, name, opts.shard_depth) < 0) {
+            printf("Failed to create the shard directories for %s\n", name);
+            goto ERRORQUIT;
+        }
+        strcpy(project, name);
+    } else if (name != NULL) {
+        abspath(dirname, name);
+        strcpy(project, name);
         if (dirname == NULL) {
             goto ERRORQUIT;
         }
-    } else if (argc == 1) {
+    } else {
         dirname[0] = '.';
         /* Can the path overflow if it is formed by os? */
         abspath(dirname, dirname);
         /* Takes the previous directory as the project if none given */
         strslice(project, dirname, &sep);
-    } else {
-        goto ERRORQUIT;
     }
 
-    create_tree(dirname);
-    create_files(dirname, project);
-    create_makes(dirname, project);
+    create_tree(dirname, &opts);
+    create_files(dirname, project, &opts);
+    create_makes(dirname, project, &opts);
+
+    /* Re-running on an existing project repairs a missing or stale entry */
+    if (opts.shard_depth > 0) {
+        struct ws_index idx;
+        const struct ws_entry *e = NULL;
+        int loaded = ws_index_load(root, &idx);
+
+        if (loaded) {
+            e = ws_index_find(&idx, project);
+        }
+        if (e == NULL || strcmp(e->path, rel) != 0) {
+            printf("\nAdding %s to %s...", project, WS_INDEX);
+            if (!ws_index_add(root, project, rel)) {
+                printf("Failed to update %s in %s\n", WS_INDEX, root);
+            } else {
+                printf("%s is at %s\n", project, rel);
+            }
+            if (e != NULL) {
+                printf("%s was indexed at %s; that tree is left as it is\n",
+                       project, e->path);
+            }
+        }
+        if (loaded) {
+            ws_index_free(&idx);
+        }
+    }
 
     return 0;
 
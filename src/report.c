@@ -0,0 +1,637 @@
+/*
+ * Workspace-wide reports over projects generated by projc
+ *
+ *      bench-report walks a workspace for the bench/results JSON
+ *      files written by the generated bench runner, parses them in
+ *      parallel and renders per-benchmark trends into a single static
+ *      HTML file with inline SVG and no network assets
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "report.h"
+#include "workspace.h"
+
+#if (defined (_WIN32) || defined (_WIN64))
+
+int bench_report_main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+    printf("bench-report is not supported on Windows; the bench harness is Linux only.\n");
+    return 1;
+}
+
+#else
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPORT_MAX_THREADS 16
+#define REPORT_FILE_MAX (256 * 1024)
+#define REPORT_BASELINE_RUNS 5
+
+struct record {
+    const char *path;       /* owned by the pathlist */
+    char project[128];
+    char benchmark[128];
+    char host[64];
+    long long timestamp;
+    double median;
+    double rel_err;
+    int converged;
+    int warnings;
+    int ok;
+};
+
+struct pathlist {
+    char **paths;
+    size_t n, cap;
+};
+
+struct parse_ctx {
+    struct pathlist *files;
+    struct record *recs;
+    size_t next;
+    pthread_mutex_t lock;
+};
+
+
+static int pathlist_add(struct pathlist *pl, const char *path) {
+    if (pl->n == pl->cap) {
+        size_t cap = pl->cap ? pl->cap * 2 : 1024;
+        char **p = realloc(pl->paths, cap * sizeof(*p));
+        if (p == NULL) {
+            return 0;
+        }
+        pl->paths = p;
+        pl->cap = cap;
+    }
+    if ((pl->paths[pl->n] = strdup(path)) == NULL) {
+        return 0;
+    }
+    pl->n++;
+    return 1;
+}
+
+
+static int has_suffix(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+
+/* Depth-first walk collecting the JSON files under bench/results; build output
+ * and VCS directories are skipped. d_type saves a stat per entry on
+ * filesystems that fill it in.
+ */
+static void collect(const char *dir, int in_bench, int in_results, struct pathlist *pl) {
+    char path[4096];
+    struct dirent *de;
+    DIR *d = opendir(dir);
+
+    if (d == NULL) {
+        return;
+    }
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        int is_dir = 0, is_reg = 0;
+        if (name[0] == '.' || strcmp(name, "build") == 0 || strcmp(name, "obj") == 0) {
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int) sizeof(path)) {
+            continue;
+        }
+        if (de->d_type == DT_DIR) {
+            is_dir = 1;
+        } else if (de->d_type == DT_REG) {
+            is_reg = 1;
+        } else if (de->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (stat(path, &st) == 0) {
+                is_dir = S_ISDIR(st.st_mode);
+                is_reg = S_ISREG(st.st_mode);
+            }
+        }
+        if (is_dir) {
+            collect(path, strcmp(name, "bench") == 0,
+                    in_bench && strcmp(name, "results") == 0, pl);
+        } else if (is_reg && in_results && has_suffix(name, ".json")) {
+            pathlist_add(pl, path);
+        }
+    }
+    closedir(d);
+}
+
+
+/* The result files are written by the generated runner, so a scan for
+ * a top-level key is enough; none of the nested keys share a name
+ */
+static const char *json_key(const char *buf, const char *key) {
+    size_t kl = strlen(key);
+    const char *p = buf;
+    while ((p = strchr(p, '"')) != NULL) {
+        if (strncmp(p + 1, key, kl) == 0 && p[kl + 1] == '"') {
+            p += kl + 2;
+            while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+                p++;
+            }
+            if (*p == ':') {
+                p++;
+                while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+                    p++;
+                }
+                return p;
+            }
+        } else {
+            p++;
+        }
+    }
+    return NULL;
+}
+
+
+static int json_string(const char *buf, const char *key, char *dest, size_t cap) {
+    const char *p = json_key(buf, key);
+    size_t n = 0;
+    if (p == NULL || *p != '"') {
+        return 0;
+    }
+    for (p++; *p != '\0' && *p != '"' && n + 1 < cap; p++) {
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+        }
+        dest[n++] = *p;
+    }
+    dest[n] = '\0';
+    return 1;
+}
+
+
+static int json_number(const char *buf, const char *key, double *dest) {
+    const char *p = json_key(buf, key);
+    char *end;
+    if (p == NULL) {
+        return 0;
+    }
+    *dest = strtod(p, &end);
+    return end != p;
+}
+
+
+/* Counts the strings in a flat array value */
+static int json_array_len(const char *buf, const char *key) {
+    const char *p = json_key(buf, key);
+    int n = 0, in_str = 0;
+    if (p == NULL || *p != '[') {
+        return 0;
+    }
+    for (p++; *p != '\0' && (in_str || *p != ']'); p++) {
+        if (*p == '\\' && in_str && p[1] != '\0') {
+            p++;
+        } else if (*p == '"') {
+            in_str = !in_str;
+            n += in_str;
+        }
+    }
+    return n;
+}
+
+
+/* buf holds REPORT_FILE_MAX + 1 bytes, reused across files */
+static void parse_one(const char *path, struct record *r, char *buf) {
+    double v;
+    ssize_t got;
+    int fd;
+
+    r->ok = 0;
+    r->path = path;
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return;
+    }
+    got = read(fd, buf, REPORT_FILE_MAX);
+    close(fd);
+    if (got <= 0) {
+        return;
+    }
+    buf[got] = '\0';
+    if (json_string(buf, "project", r->project, sizeof(r->project)) &&
+            json_string(buf, "benchmark", r->benchmark, sizeof(r->benchmark)) &&
+            json_number(buf, "timestamp", &v)) {
+        r->timestamp = (long long) v;
+        r->ok = json_number(buf, "median", &r->median);
+        if (!json_number(buf, "rel_err", &r->rel_err)) {
+            r->rel_err = 0.0;
+        }
+        if (!json_string(buf, "host", r->host, sizeof(r->host))) {
+            strcpy(r->host, "?");
+        }
+        r->converged = strncmp(json_key(buf, "converged") ? json_key(buf, "converged")
+                               : "true", "false", 5) != 0;
+        r->warnings = json_array_len(buf, "warnings");
+    }
+}
+
+
+static void *parse_worker(void *arg) {
+    struct parse_ctx *c = arg;
+    char *buf = malloc(REPORT_FILE_MAX + 1);
+    for (;;) {
+        size_t lo, hi;
+        /* Hand out small batches; one lock per 64 files is noise */
+        pthread_mutex_lock(&c->lock);
+        lo = c->next;
+        hi = lo + 64 < c->files->n ? lo + 64 : c->files->n;
+        c->next = hi;
+        pthread_mutex_unlock(&c->lock);
+        if (lo >= hi) {
+            break;
+        }
+        for (size_t i = lo; i < hi; i++) {
+            if (buf != NULL) {
+                parse_one(c->files->paths[i], &c->recs[i], buf);
+            } else {
+                c->recs[i].ok = 0;
+            }
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+
+static void parse_all(struct pathlist *pl, struct record *recs) {
+    struct parse_ctx c;
+    pthread_t tids[REPORT_MAX_THREADS];
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > REPORT_MAX_THREADS ? REPORT_MAX_THREADS : (int) ncpu;
+    int started = 0;
+
+    c.files = pl;
+    c.recs = recs;
+    c.next = 0;
+    pthread_mutex_init(&c.lock, NULL);
+    if ((size_t) nthreads > pl->n / 64 + 1) {
+        nthreads = (int) (pl->n / 64 + 1);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&tids[started], NULL, parse_worker, &c) == 0) {
+            started++;
+        }
+    }
+    parse_worker(&c);
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_mutex_destroy(&c.lock);
+}
+
+
+static int by_series(const void *a, const void *b) {
+    const struct record *x = a, *y = b;
+    int c = strcmp(x->project, y->project);
+    if (c == 0) {
+        c = strcmp(x->benchmark, y->benchmark);
+    }
+    if (c == 0) {
+        c = (x->timestamp > y->timestamp) - (x->timestamp < y->timestamp);
+    }
+    if (c == 0) {
+        c = strcmp(x->path, y->path);
+    }
+    return c;
+}
+
+
+static int by_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* One benchmark of one project, runs in time order */
+struct series {
+    struct record *runs;
+    size_t n;
+    double baseline;    /* median of the previous runs' medians */
+    double change;      /* latest over baseline, minus one */
+    int status;         /* 1 regression, -1 improvement, 0 neither */
+};
+
+
+static void classify(struct series *s, double threshold) {
+    double prev[REPORT_BASELINE_RUNS];
+    size_t k = 0;
+    const struct record *last = &s->runs[s->n - 1];
+    double limit;
+
+    s->status = 0;
+    s->change = 0.0;
+    s->baseline = last->median;
+    if (s->n < 2) {
+        return;
+    }
+    for (size_t i = s->n - 1; i > 0 && k < REPORT_BASELINE_RUNS; i--) {
+        prev[k++] = s->runs[i - 1].median;
+    }
+    qsort(prev, k, sizeof(double), by_double);
+    s->baseline = k % 2 ? prev[k / 2] : (prev[k / 2 - 1] + prev[k / 2]) / 2;
+    if (s->baseline <= 0.0) {
+        return;
+    }
+    s->change = last->median / s->baseline - 1.0;
+    /* A change inside the run's own noise is not a verdict */
+    limit = threshold > 3.0 * last->rel_err ? threshold : 3.0 * last->rel_err;
+    if (s->change > limit) {
+        s->status = 1;
+    } else if (s->change < -limit) {
+        s->status = -1;
+    }
+}
+
+
+/* Regressions first, worst first; qsort is not stable, so ties fall
+ * back to the series' project and latest run to keep reports stable
+ */
+static int by_status(const void *a, const void *b) {
+    const struct series *x = a, *y = b;
+    int c = (y->status == 1) - (x->status == 1);
+    if (c == 0 && x->status == 1) {
+        c = (x->change < y->change) - (x->change > y->change);
+    }
+    if (c == 0) {
+        c = strcmp(x->runs[0].project, y->runs[0].project);
+    }
+    if (c == 0) {
+        c = strcmp(x->runs[x->n - 1].path, y->runs[y->n - 1].path);
+    }
+    return c;
+}
+
+
+static void html_text(FILE *fp, const char *s) {
+    for (; *s != '\0'; s++) {
+        switch (*s) {
+            case '<':
+                fputs("&lt;", fp);
+                break;
+            case '>':
+                fputs("&gt;", fp);
+                break;
+            case '&':
+                fputs("&amp;", fp);
+                break;
+            case '"':
+                fputs("&quot;", fp);
+                break;
+            default:
+                fputc(*s, fp);
+        }
+    }
+}
+
+
+static void format_ns(char *dest, size_t cap, double ns) {
+    if (ns >= 1e9) {
+        snprintf(dest, cap, "%.3f s", ns / 1e9);
+    } else if (ns >= 1e6) {
+        snprintf(dest, cap, "%.3f ms", ns / 1e6);
+    } else if (ns >= 1e3) {
+        snprintf(dest, cap, "%.3f us", ns / 1e3);
+    } else {
+        snprintf(dest, cap, "%.2f ns", ns);
+    }
+}
+
+
+/* Median per run over time, the latest run as a dot */
+static void sparkline(FILE *fp, const struct series *s) {
+    const double w = 240.0, h = 48.0, pad = 4.0;
+    double lo = s->runs[0].median, hi = lo;
+    const char *color = s->status == 1 ? "#c0392b" : s->status == -1 ? "#27ae60" : "#2c3e50";
+
+    for (size_t i = 1; i < s->n; i++) {
+        lo = s->runs[i].median < lo ? s->runs[i].median : lo;
+        hi = s->runs[i].median > hi ? s->runs[i].median : hi;
+    }
+    if (hi - lo < hi * 1e-9) {
+        lo -= 1.0;
+        hi += 1.0;
+    }
+    fprintf(fp, "<svg width=\"%.0f\" height=\"%.0f\" viewBox=\"0 0 %.0f %.0f\">"
+            "<polyline fill=\"none\" stroke=\"%s\" stroke-width=\"1.5\" points=\"",
+            w, h, w, h, color);
+    for (size_t i = 0; i < s->n; i++) {
+        double x = s->n > 1 ? pad + (w - 2 * pad) * i / (s->n - 1) : w / 2;
+        double y = h - pad - (h - 2 * pad) * (s->runs[i].median - lo) / (hi - lo);
+        fprintf(fp, "%.1f,%.1f ", x, y);
+        if (i + 1 == s->n) {
+            fprintf(fp, "\"/><circle cx=\"%.1f\" cy=\"%.1f\" r=\"3\" fill=\"%s\"/>",
+                    x, y, color);
+        }
+    }
+    fputs("</svg>", fp);
+}
+
+
+static int render(const char *out, const char *dir, struct series *ss, size_t nseries,
+                  size_t nfiles, size_t nbad, double threshold) {
+    char tmp[4096], a[32], b[32], when[32];
+    size_t nreg = 0, nimp = 0;
+    time_t now = time(NULL);
+    FILE *fp;
+
+    for (size_t i = 0; i < nseries; i++) {
+        nreg += ss[i].status == 1;
+        nimp += ss[i].status == -1;
+    }
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", out) >= (int) sizeof(tmp) ||
+            (fp = fopen(tmp, "w")) == NULL) {
+        return 0;
+    }
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&now));
+    fputs("<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\">"
+          "<title>Benchmark report</title>\n<style>\n"
+          "body{font:14px/1.4 sans-serif;margin:2em;color:#222}\n"
+          "table{border-collapse:collapse}\n"
+          "th,td{padding:4px 10px;border-bottom:1px solid #ddd;text-align:left}\n"
+          "td.num{text-align:right;font-family:monospace}\n"
+          "tr.reg{background:#fdecea}\ntr.imp{background:#eafaf1}\n"
+          ".warn{color:#b9770e}\n</style></head><body>\n", fp);
+    fputs("<h1>Benchmark report</h1>\n<p>", fp);
+    html_text(fp, dir);
+    fprintf(fp, " &middot; %s &middot; %zu result files, %zu benchmarks, "
+            "<b>%zu regressions</b>, %zu improvements",
+            when, nfiles, nseries, nreg, nimp);
+    if (nbad > 0) {
+        fprintf(fp, ", <span class=\"warn\">%zu unreadable files</span>", nbad);
+    }
+    fprintf(fp, ". A change counts when it exceeds %.1f%% and three times the"
+            " run's own standard error, against the median of up to %d"
+            " previous runs.</p>\n", threshold * 100.0, REPORT_BASELINE_RUNS);
+    fputs("<table>\n<tr><th>project</th><th>benchmark</th><th>runs</th>"
+          "<th>latest</th><th>baseline</th><th>change</th><th>trend</th>"
+          "<th>notes</th></tr>\n", fp);
+    for (size_t i = 0; i < nseries; i++) {
+        const struct series *s = &ss[i];
+        const struct record *last = &s->runs[s->n - 1];
+        fprintf(fp, "<tr%s><td>", s->status == 1 ? " class=\"reg\""
+                : s->status == -1 ? " class=\"imp\"" : "");
+        html_text(fp, last->project);
+        fputs("</td><td>", fp);
+        html_text(fp, last->benchmark);
+        format_ns(a, sizeof(a), last->median);
+        format_ns(b, sizeof(b), s->baseline);
+        fprintf(fp, "</td><td class=\"num\">%zu</td><td class=\"num\">%s</td>"
+                "<td class=\"num\">%s</td><td class=\"num\">%+.1f%%</td><td>",
+                s->n, a, b, s->change * 100.0);
+        sparkline(fp, s);
+        fputs("</td><td>", fp);
+        if (!last->converged) {
+            fputs("<span class=\"warn\">not converged</span> ", fp);
+        }
+        if (last->warnings > 0) {
+            fprintf(fp, "<span class=\"warn\">%d machine warnings</span> ", last->warnings);
+        }
+        if (s->n > 1 && strcmp(last->host, s->runs[s->n - 2].host) != 0) {
+            fputs("<span class=\"warn\">host changed</span>", fp);
+        }
+        fputs("</td></tr>\n", fp);
+    }
+    fputs("</table>\n</body></html>\n", fp);
+    if (fclose(fp) != 0 || rename(tmp, out) != 0) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+
+int bench_report_main(int argc, char *argv[]) {
+    const char *dir = NULL, *out = NULL;
+    char outbuf[4096];
+    double threshold = 0.05;
+    struct pathlist pl = {0};
+    struct record *recs;
+    struct series *ss;
+    size_t nok = 0, nseries = 0;
+    struct timespec t0, t1;
+    struct ws_index idx;
+    int ret = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]) / 100.0;
+        } else if (argv[i][0] != '-' && dir == NULL) {
+            dir = argv[i];
+        } else {
+            dir = NULL;
+            break;
+        }
+    }
+    if (dir == NULL) {
+        printf("usage: projc bench-report DIR [-o FILE] [--threshold PCT]\n");
+        return 1;
+    }
+    if (out == NULL) {
+        snprintf(outbuf, sizeof(outbuf), "%s/bench-report.html", dir);
+        out = outbuf;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    /* A sharded workspace lists its projects; only their results are read */
+    if (ws_index_load(dir, &idx)) {
+        for (size_t i = 0; i < idx.n; i++) {
+            char results[4096];
+            if (snprintf(results, sizeof(results), "%s/%s/bench/results", dir,
+                         idx.entries[i].path) < (int) sizeof(results)) {
+                collect(results, 0, 1, &pl);
+            }
+        }
+        printf("Using %s: %zu projects\n", WS_INDEX, idx.n);
+        ws_index_free(&idx);
+    } else {
+        collect(dir, 0, 0, &pl);
+    }
+    if (pl.n == 0) {
+        printf("No bench/results/*.json found under %s\n", dir);
+        return 1;
+    }
+    recs = calloc(pl.n, sizeof(*recs));
+    ss = calloc(pl.n, sizeof(*ss));
+    if (recs == NULL || ss == NULL) {
+        goto done;
+    }
+    parse_all(&pl, recs);
+
+    for (size_t i = 0; i < pl.n; i++) {
+        if (recs[i].ok) {
+            recs[nok++] = recs[i];
+        }
+    }
+    qsort(recs, nok, sizeof(*recs), by_series);
+    for (size_t i = 0; i < nok; i++) {
+        if (i == 0 || strcmp(recs[i].project, recs[i - 1].project) != 0 ||
+                strcmp(recs[i].benchmark, recs[i - 1].benchmark) != 0) {
+            ss[nseries].runs = &recs[i];
+            ss[nseries++].n = 0;
+        }
+        ss[nseries - 1].n++;
+    }
+    for (size_t i = 0; i < nseries; i++) {
+        classify(&ss[i], threshold);
+    }
+    qsort(ss, nseries, sizeof(*ss), by_status);
+
+    if (render(out, dir, ss, nseries, pl.n, pl.n - nok, threshold)) {
+        size_t nreg = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (size_t i = 0; i < nseries; i++) {
+            nreg += ss[i].status == 1;
+        }
+        printf("%zu result files, %zu benchmarks, %zu regressions in %.1f ms\n"
+               "Report written to %s\n", pl.n, nseries, nreg,
+               (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6, out);
+        ret = 0;
+    } else {
+        printf("Failed to write %s\n", out);
+    }
+
+done:
+    for (size_t i = 0; i < pl.n; i++) {
+        free(pl.paths[i]);
+    }
+    free(pl.paths);
+    free(recs);
+    free(ss);
+    return ret;
+}
+
+#endif
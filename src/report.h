@@ -0,0 +1,22 @@
+/*
+ * Workspace-wide reports over projects generated by projc
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ */
+
+#ifndef PROJC_REPORT_H
+#define PROJC_REPORT_H
+
+/* projc bench-report DIR [-o FILE] [--threshold PCT]
+ *      Collects bench/results JSON files below DIR and renders trends
+ *      and regressions as one self-contained HTML file
+ */
+int bench_report_main(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,621 @@
+/*
+ * Templates for the bench harness generated into every project: a
+ *      runner that pins to chosen CPUs, records cpufreq, turbo, THP
+ *      and background load, repeats until the mean converges and
+ *      stores each result with its environment as JSON.
+ */
+
+#ifndef TMPL_BENCH_H
+#define TMPL_BENCH_H
+
+/* bench/Project_benchenv.h */
+static const char BENCHENV_H[] = "\
+#ifndef @GUARD@_BENCHENV_H\n\
+#define @GUARD@_BENCHENV_H\n\
+\n\
+/* Benchmark runner that controls for machine noise: pins to a chosen\n\
+ * CPU, records the cpufreq governor, turbo, THP and SMT state,\n\
+ * measures background load from /proc/loadavg and /proc/stat deltas,\n\
+ * and repeats each benchmark until its mean converges. Every result\n\
+ * is written with its environment to bench/results/NAME-TIME.json\n\
+ * (NAME-TIME-N.json for later runs within the same second).\n\
+ *\n\
+ * Environment:\n\
+ *      BENCH_CPUS    CPUs to use, e.g. \"2,3\" or \"2-5\" (default: one\n\
+ *                    SMT thread per core, skipping CPU 0); the first\n\
+ *                    runs the benchmark, the rest are for its threads\n\
+ *      BENCH_STRICT  1 refuses to run when results would be noise\n\
+ *      BENCH_TARGET  relative error to converge to (default 0.005)\n\
+ *      BENCH_MAX_S   time limit per benchmark in seconds (default 30)\n\
+ */\n\
+\n\
+#include <stdint.h>\n\
+\n\
+#define BENCHENV_MAX_CPUS 64\n\
+#define BENCHENV_MAX_WARN 8\n\
+#define BENCHENV_WARN_LEN 96\n\
+\n\
+struct benchenv {\n\
+    int cpus[BENCHENV_MAX_CPUS];    /* pinned set */\n\
+    int ncpus;\n\
+    int online;\n\
+    int smt_shared;                 /* two pinned CPUs share a core */\n\
+    char governor[32];              /* of the pinned CPUs, \"mixed\" if not all alike */\n\
+    char turbo[16];                 /* \"on\", \"off\" or \"unknown\" */\n\
+    char thp[16];\n\
+    double loadavg1;\n\
+    double busy_other;              /* % busy of unpinned CPUs while idle */\n\
+    double busy_pinned;             /* % busy of pinned CPUs while idle */\n\
+    char warnings[BENCHENV_MAX_WARN][BENCHENV_WARN_LEN];\n\
+    int nwarnings;\n\
+    int fatal;                      /* warnings that make results noise */\n\
+};\n\
+\n\
+struct bench_result {\n\
+    double mean;        /* ns per operation */\n\
+    double median;\n\
+    double min;\n\
+    double stddev;\n\
+    double rel_err;     /* standard error of the mean over the mean */\n\
+    uint64_t iters;     /* operations per sample */\n\
+    int samples;\n\
+    int converged;\n\
+};\n\
+\n\
+/* Operation under test: run it iters times */\n\
+typedef void (*bench_fn)(void *arg, uint64_t iters);\n\
+\n\
+/* Pins the calling thread to cpus[0] and probes the machine; -1 when\n\
+ * BENCH_STRICT is set and the machine state makes results meaningless\n\
+ */\n\
+int benchenv_setup(struct benchenv *env);\n\
+\n\
+/* Pins the calling thread to the i-th chosen CPU (modulo their\n\
+ * number), for benchmarks that start their own threads; threads\n\
+ * inherit the measuring thread's cpus[0] until they call this\n\
+ */\n\
+int benchenv_pin_thread(const struct benchenv *env, unsigned i);\n\
+\n\
+/* Measures fn, prints a summary line and stores the JSON result */\n\
+int bench_run(const struct benchenv *env, const char *name, bench_fn fn,\n\
+              void *arg, struct bench_result *r);\n\
+\n\
+#endif\n";
+
+
+/* bench/Project_benchenv.c */
+static const char BENCHENV_C[] = "\
+#define _GNU_SOURCE\n\
+#include <errno.h>\n\
+#include <math.h>\n\
+#include <sched.h>\n\
+#include <stdarg.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <sys/stat.h>\n\
+#include <time.h>\n\
+#include <unistd.h>\n\
+\n\
+#include \"@PROJECT@_benchenv.h\"\n\
+\n\
+#define BENCH_MIN_SAMPLE_NS 10000000.0     /* 10 ms per sample */\n\
+#define BENCH_MIN_SAMPLES 10\n\
+#define BENCH_MAX_SAMPLES 1000\n\
+\n\
+static uint64_t now_ns(void) {\n\
+    struct timespec ts;\n\
+    clock_gettime(CLOCK_MONOTONIC, &ts);\n\
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;\n\
+}\n\
+\n\
+/* First line of a small sysfs/procfs file, newline stripped */\n\
+static int read_line(const char *path, char *buf, size_t cap) {\n\
+    FILE *fp = fopen(path, \"r\");\n\
+    if (fp == NULL) {\n\
+        return -1;\n\
+    }\n\
+    if (fgets(buf, (int) cap, fp) == NULL) {\n\
+        fclose(fp);\n\
+        return -1;\n\
+    }\n\
+    fclose(fp);\n\
+    buf[strcspn(buf, \"\\n\")] = '\\0';\n\
+    return 0;\n\
+}\n\
+\n\
+static void warn(struct benchenv *env, int fatal, const char *fmt, ...) {\n\
+    va_list ap;\n\
+    if (env->nwarnings == BENCHENV_MAX_WARN) {\n\
+        return;\n\
+    }\n\
+    va_start(ap, fmt);\n\
+    vsnprintf(env->warnings[env->nwarnings++], BENCHENV_WARN_LEN, fmt, ap);\n\
+    va_end(ap);\n\
+    env->fatal += fatal;\n\
+}\n\
+\n\
+/* Parses \"2,4-6\" into a cpu_set_t */\n\
+static int parse_cpus(const char *list, cpu_set_t *set) {\n\
+    const char *p = list;\n\
+    CPU_ZERO(set);\n\
+    while (*p != '\\0') {\n\
+        char *end;\n\
+        long lo = strtol(p, &end, 10), hi;\n\
+        if (end == p) {\n\
+            return -1;\n\
+        }\n\
+        hi = lo;\n\
+        if (*end == '-') {\n\
+            p = end + 1;\n\
+            hi = strtol(p, &end, 10);\n\
+            if (end == p) {\n\
+                return -1;\n\
+            }\n\
+        }\n\
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++) {\n\
+            CPU_SET(c, set);\n\
+        }\n\
+        p = *end == ',' ? end + 1 : end;\n\
+        if (*end != ',' && *end != '\\0') {\n\
+            return -1;\n\
+        }\n\
+    }\n\
+    return 0;\n\
+}\n\
+\n\
+static int siblings(int cpu, cpu_set_t *set) {\n\
+    char path[128], buf[256];\n\
+    snprintf(path, sizeof(path),\n\
+             \"/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list\", cpu);\n\
+    if (read_line(path, buf, sizeof(buf)) != 0) {\n\
+        CPU_ZERO(set);\n\
+        CPU_SET(cpu, set);\n\
+        return -1;\n\
+    }\n\
+    return parse_cpus(buf, set);\n\
+}\n\
+\n\
+/* Default set: allowed CPUs, one thread per core, CPU 0 left to\n\
+ * interrupts and housekeeping when there is anything else\n\
+ */\n\
+static void choose_cpus(struct benchenv *env, const cpu_set_t *allowed) {\n\
+    cpu_set_t taken;\n\
+    int first = -1;\n\
+    CPU_ZERO(&taken);\n\
+    for (int c = 0; c < CPU_SETSIZE && env->ncpus < BENCHENV_MAX_CPUS; c++) {\n\
+        cpu_set_t sib;\n\
+        if (!CPU_ISSET(c, allowed)) {\n\
+            continue;\n\
+        }\n\
+        if (first < 0) {\n\
+            first = c;\n\
+        }\n\
+        if (c == 0 || CPU_ISSET(c, &taken)) {\n\
+            continue;\n\
+        }\n\
+        siblings(c, &sib);\n\
+        CPU_OR(&taken, &taken, &sib);\n\
+        env->cpus[env->ncpus++] = c;\n\
+    }\n\
+    if (env->ncpus == 0 && first >= 0) {\n\
+        env->cpus[env->ncpus++] = first;\n\
+    }\n\
+}\n\
+\n\
+static void probe_freq(struct benchenv *env) {\n\
+    char path[128], buf[64];\n\
+    strcpy(env->governor, \"unknown\");\n\
+    for (int i = 0; i < env->ncpus; i++) {\n\
+        snprintf(path, sizeof(path),\n\
+                 \"/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor\",\n\
+                 env->cpus[i]);\n\
+        if (read_line(path, buf, sizeof(buf)) != 0) {\n\
+            continue;\n\
+        }\n\
+        if (strcmp(env->governor, \"unknown\") == 0) {\n\
+            snprintf(env->governor, sizeof(env->governor), \"%.31s\", buf);\n\
+        } else if (strcmp(env->governor, buf) != 0) {\n\
+            strcpy(env->governor, \"mixed\");\n\
+        }\n\
+    }\n\
+    if (strcmp(env->governor, \"unknown\") != 0 &&\n\
+            strcmp(env->governor, \"performance\") != 0) {\n\
+        warn(env, 1, \"cpufreq governor is %s, not performance\", env->governor);\n\
+    }\n\
+\n\
+    strcpy(env->turbo, \"unknown\");\n\
+    if (read_line(\"/sys/devices/system/cpu/intel_pstate/no_turbo\", buf, sizeof(buf)) == 0) {\n\
+        strcpy(env->turbo, buf[0] == '1' ? \"off\" : \"on\");\n\
+    } else if (read_line(\"/sys/devices/system/cpu/cpufreq/boost\", buf, sizeof(buf)) == 0) {\n\
+        strcpy(env->turbo, buf[0] == '1' ? \"on\" : \"off\");\n\
+    }\n\
+    if (strcmp(env->turbo, \"on\") == 0) {\n\
+        warn(env, 0, \"turbo boost is on; clocks follow temperature and load\");\n\
+    }\n\
+}\n\
+\n\
+static void probe_thp(struct benchenv *env) {\n\
+    char buf[128], *l, *r;\n\
+    strcpy(env->thp, \"unknown\");\n\
+    if (read_line(\"/sys/kernel/mm/transparent_hugepage/enabled\", buf, sizeof(buf)) == 0 &&\n\
+            (l = strchr(buf, '[')) != NULL && (r = strchr(l, ']')) != NULL) {\n\
+        *r = '\\0';\n\
+        snprintf(env->thp, sizeof(env->thp), \"%s\", l + 1);\n\
+    }\n\
+}\n\
+\n\
+struct cpu_times {\n\
+    unsigned long long busy, total;\n\
+};\n\
+\n\
+static int read_stat(struct cpu_times *t, int n) {\n\
+    char line[512];\n\
+    FILE *fp = fopen(\"/proc/stat\", \"r\");\n\
+    memset(t, 0, n * sizeof(*t));\n\
+    if (fp == NULL) {\n\
+        return -1;\n\
+    }\n\
+    while (fgets(line, sizeof(line), fp) != NULL) {\n\
+        unsigned long long v[8] = {0};\n\
+        int cpu;\n\
+        if (sscanf(line, \"cpu%d %llu %llu %llu %llu %llu %llu %llu %llu\", &cpu,\n\
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) < 5 ||\n\
+                cpu < 0 || cpu >= n) {\n\
+            continue;\n\
+        }\n\
+        for (int i = 0; i < 8; i++) {\n\
+            t[cpu].total += v[i];\n\
+        }\n\
+        t[cpu].busy = t[cpu].total - v[3] - v[4];   /* minus idle, iowait */\n\
+    }\n\
+    fclose(fp);\n\
+    return 0;\n\
+}\n\
+\n\
+/* Background load while this process sleeps: anything measured is\n\
+ * somebody else's\n\
+ */\n\
+static void probe_load(struct benchenv *env) {\n\
+    struct cpu_times *t0, *t1;\n\
+    unsigned long long pb = 0, pt = 0, ob = 0, ot = 0;\n\
+    int n = env->online > 0 ? env->online : 1;\n\
+    char buf[128];\n\
+\n\
+    if (read_line(\"/proc/loadavg\", buf, sizeof(buf)) == 0) {\n\
+        env->loadavg1 = atof(buf);\n\
+    }\n\
+    t0 = calloc(n, sizeof(*t0));\n\
+    t1 = calloc(n, sizeof(*t1));\n\
+    if (t0 != NULL && t1 != NULL && read_stat(t0, n) == 0) {\n\
+        usleep(250000);\n\
+        read_stat(t1, n);\n\
+        for (int c = 0; c < n; c++) {\n\
+            int pinned = 0;\n\
+            for (int i = 0; i < env->ncpus; i++) {\n\
+                pinned |= env->cpus[i] == c;\n\
+            }\n\
+            if (pinned) {\n\
+                pb += t1[c].busy - t0[c].busy;\n\
+                pt += t1[c].total - t0[c].total;\n\
+            } else {\n\
+                ob += t1[c].busy - t0[c].busy;\n\
+                ot += t1[c].total - t0[c].total;\n\
+            }\n\
+        }\n\
+        env->busy_pinned = pt ? 100.0 * pb / pt : 0.0;\n\
+        env->busy_other = ot ? 100.0 * ob / ot : 0.0;\n\
+    }\n\
+    free(t0);\n\
+    free(t1);\n\
+\n\
+    if (env->busy_pinned > 5.0) {\n\
+        warn(env, 1, \"pinned CPUs are %.1f%% busy with other work\", env->busy_pinned);\n\
+    }\n\
+    if (env->busy_other > 25.0) {\n\
+        warn(env, 0, \"other CPUs are %.1f%% busy; shared caches and memory\"\n\
+             \" bandwidth are contended\", env->busy_other);\n\
+    }\n\
+    if (env->loadavg1 > env->online) {\n\
+        warn(env, 1, \"load average %.2f exceeds %d online CPUs\",\n\
+             env->loadavg1, env->online);\n\
+    }\n\
+}\n\
+\n\
+int benchenv_setup(struct benchenv *env) {\n\
+    const char *cpus = getenv(\"BENCH_CPUS\");\n\
+    const char *strict = getenv(\"BENCH_STRICT\");\n\
+    cpu_set_t allowed, set;\n\
+\n\
+    memset(env, 0, sizeof(*env));\n\
+    env->online = (int) sysconf(_SC_NPROCESSORS_ONLN);\n\
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {\n\
+        CPU_ZERO(&allowed);\n\
+        CPU_SET(0, &allowed);\n\
+    }\n\
+    if (cpus != NULL && *cpus != '\\0') {\n\
+        if (parse_cpus(cpus, &set) != 0) {\n\
+            fprintf(stderr, \"bench: cannot parse BENCH_CPUS=%s\\n\", cpus);\n\
+            return -1;\n\
+        }\n\
+        for (int c = 0; c < CPU_SETSIZE && env->ncpus < BENCHENV_MAX_CPUS; c++) {\n\
+            if (CPU_ISSET(c, &set)) {\n\
+                env->cpus[env->ncpus++] = c;\n\
+            }\n\
+        }\n\
+    } else {\n\
+        choose_cpus(env, &allowed);\n\
+    }\n\
+\n\
+    for (int i = 0; i < env->ncpus; i++) {\n\
+        for (int j = 0; j < i; j++) {\n\
+            cpu_set_t sib;\n\
+            siblings(env->cpus[i], &sib);\n\
+            if (CPU_ISSET(env->cpus[j], &sib)) {\n\
+                env->smt_shared = 1;\n\
+            }\n\
+        }\n\
+    }\n\
+    /* The measuring thread gets cpus[0] to itself; helper threads\n\
+     * inherit that until they move with benchenv_pin_thread\n\
+     */\n\
+    if (env->ncpus == 0 || benchenv_pin_thread(env, 0) != 0) {\n\
+        warn(env, 1, \"cannot pin to the chosen CPUs: %s\", strerror(errno));\n\
+    }\n\
+    if (env->smt_shared) {\n\
+        warn(env, 0, \"pinned CPUs include SMT siblings of one core\");\n\
+    }\n\
+\n\
+    probe_freq(env);\n\
+    probe_thp(env);\n\
+    probe_load(env);\n\
+\n\
+    for (int i = 0; i < env->nwarnings; i++) {\n\
+        fprintf(stderr, \"bench: warning: %s\\n\", env->warnings[i]);\n\
+    }\n\
+    if (strict != NULL && atoi(strict) != 0 && env->fatal > 0) {\n\
+        fprintf(stderr, \"bench: BENCH_STRICT is set and the machine is too\"\n\
+                \" noisy for meaningful results\\n\");\n\
+        return -1;\n\
+    }\n\
+    return 0;\n\
+}\n\
+\n\
+int benchenv_pin_thread(const struct benchenv *env, unsigned i) {\n\
+    cpu_set_t set;\n\
+    if (env->ncpus == 0) {\n\
+        return -1;\n\
+    }\n\
+    CPU_ZERO(&set);\n\
+    CPU_SET(env->cpus[i % env->ncpus], &set);\n\
+    return sched_setaffinity(0, sizeof(set), &set);\n\
+}\n\
+\n\
+static int cmp_double(const void *a, const void *b) {\n\
+    double x = *(const double *) a, y = *(const double *) b;\n\
+    return (x > y) - (x < y);\n\
+}\n\
+\n\
+/* Interference only ever makes a sample slower, so the slowest tenth\n\
+ * is dropped before the mean and its error are taken\n\
+ */\n\
+static void summarize(double *s, int n, struct bench_result *r) {\n\
+    double sum = 0.0, sq = 0.0;\n\
+    int keep;\n\
+    qsort(s, n, sizeof(double), cmp_double);\n\
+    keep = n - n / 10;\n\
+    for (int i = 0; i < keep; i++) {\n\
+        sum += s[i];\n\
+    }\n\
+    r->mean = sum / keep;\n\
+    for (int i = 0; i < keep; i++) {\n\
+        sq += (s[i] - r->mean) * (s[i] - r->mean);\n\
+    }\n\
+    r->stddev = keep > 1 ? sqrt(sq / (keep - 1)) : 0.0;\n\
+    r->rel_err = r->mean > 0.0 ? r->stddev / sqrt(keep) / r->mean : 0.0;\n\
+    r->median = n % 2 ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;\n\
+    r->min = s[0];\n\
+    r->samples = n;\n\
+}\n\
+\n\
+static void json_str(FILE *fp, const char *s) {\n\
+    fputc('\"', fp);\n\
+    for (; *s != '\\0'; s++) {\n\
+        if (*s == '\"' || *s == '\\\\') {\n\
+            fputc('\\\\', fp);\n\
+        }\n\
+        fputc((unsigned char) *s < 0x20 ? ' ' : *s, fp);\n\
+    }\n\
+    fputc('\"', fp);\n\
+}\n\
+\n\
+static int write_json(const struct benchenv *env, const char *name,\n\
+                      const struct bench_result *r) {\n\
+    char path[512], tmp[520], host[128] = \"unknown\";\n\
+    time_t now = time(NULL);\n\
+    FILE *fp;\n\
+    size_t at;\n\
+    int ret = -1;\n\
+\n\
+    mkdir(\"bench\", 0755);\n\
+    mkdir(\"bench/results\", 0755);\n\
+    at = (size_t) snprintf(path, sizeof(path), \"bench/results/\");\n\
+    for (const char *p = name; *p != '\\0' && at < 400; p++) {\n\
+        path[at++] = (*p == '/' || *p == ' ') ? '_' : *p;\n\
+    }\n\
+    snprintf(tmp, sizeof(tmp), \"%.*s-%lld.%ld.tmp\", (int) at, path, (long long) now,\n\
+             (long) getpid());\n\
+    gethostname(host, sizeof(host) - 1);\n\
+\n\
+    if ((fp = fopen(tmp, \"w\")) == NULL) {\n\
+        return -1;\n\
+    }\n\
+    fprintf(fp, \"{\\n  \\\"project\\\": \");\n\
+    json_str(fp, \"@PROJECT@\");\n\
+    fprintf(fp, \",\\n  \\\"benchmark\\\": \");\n\
+    json_str(fp, name);\n\
+    fprintf(fp, \",\\n  \\\"timestamp\\\": %lld,\\n  \\\"host\\\": \", (long long) now);\n\
+    json_str(fp, host);\n\
+    fprintf(fp, \",\\n  \\\"unit\\\": \\\"ns/op\\\",\\n\"\n\
+            \"  \\\"median\\\": %.3f,\\n  \\\"mean\\\": %.3f,\\n  \\\"min\\\": %.3f,\\n\"\n\
+            \"  \\\"stddev\\\": %.3f,\\n  \\\"rel_err\\\": %.5f,\\n\"\n\
+            \"  \\\"samples\\\": %d,\\n  \\\"iters_per_sample\\\": %llu,\\n\"\n\
+            \"  \\\"converged\\\": %s,\\n\",\n\
+            r->median, r->mean, r->min, r->stddev, r->rel_err, r->samples,\n\
+            (unsigned long long) r->iters, r->converged ? \"true\" : \"false\");\n\
+    fprintf(fp, \"  \\\"env\\\": {\\n    \\\"cpus\\\": [\");\n\
+    for (int i = 0; i < env->ncpus; i++) {\n\
+        fprintf(fp, \"%s%d\", i ? \", \" : \"\", env->cpus[i]);\n\
+    }\n\
+    fprintf(fp, \"],\\n    \\\"online\\\": %d,\\n    \\\"smt_shared\\\": %s,\\n\"\n\
+            \"    \\\"governor\\\": \", env->online, env->smt_shared ? \"true\" : \"false\");\n\
+    json_str(fp, env->governor);\n\
+    fprintf(fp, \",\\n    \\\"turbo\\\": \");\n\
+    json_str(fp, env->turbo);\n\
+    fprintf(fp, \",\\n    \\\"thp\\\": \");\n\
+    json_str(fp, env->thp);\n\
+    fprintf(fp, \",\\n    \\\"loadavg1\\\": %.2f,\\n    \\\"busy_pinned_pct\\\": %.1f,\\n\"\n\
+            \"    \\\"busy_other_pct\\\": %.1f\\n  },\\n  \\\"warnings\\\": [\",\n\
+            env->loadavg1, env->busy_pinned, env->busy_other);\n\
+    for (int i = 0; i < env->nwarnings; i++) {\n\
+        fputs(i ? \", \" : \"\", fp);\n\
+        json_str(fp, env->warnings[i]);\n\
+    }\n\
+    fprintf(fp, \"]\\n}\\n\");\n\
+    /* link() never replaces a file, so a second run in the same second\n\
+     * gets the next suffix instead of overwriting the first\n\
+     */\n\
+    if (fclose(fp) == 0) {\n\
+        for (int i = 0; i < 1000 && ret != 0; i++) {\n\
+            snprintf(path + at, sizeof(path) - at, i ? \"-%lld-%d.json\" : \"-%lld.json\",\n\
+                     (long long) now, i);\n\
+            if (link(tmp, path) == 0) {\n\
+                ret = 0;\n\
+            } else if (errno != EEXIST) {\n\
+                /* No hard links here: fall back to a plain rename */\n\
+                ret = rename(tmp, path) == 0 ? 0 : -1;\n\
+                break;\n\
+            }\n\
+        }\n\
+    }\n\
+    unlink(tmp);\n\
+    return ret;\n\
+}\n\
+\n\
+int bench_run(const struct benchenv *env, const char *name, bench_fn fn,\n\
+              void *arg, struct bench_result *r) {\n\
+    const char *target_env = getenv(\"BENCH_TARGET\");\n\
+    const char *max_env = getenv(\"BENCH_MAX_S\");\n\
+    double target = target_env != NULL ? atof(target_env) : 0.005;\n\
+    double max_ns = (max_env != NULL ? atof(max_env) : 30.0) * 1e9;\n\
+    double *s = malloc(BENCH_MAX_SAMPLES * sizeof(double));\n\
+    uint64_t iters = 1, t0, start;\n\
+    int n = 0;\n\
+\n\
+    if (s == NULL) {\n\
+        return -1;\n\
+    }\n\
+    memset(r, 0, sizeof(*r));\n\
+\n\
+    /* Calibrate so one sample takes at least BENCH_MIN_SAMPLE_NS; the\n\
+     * calibration runs double as warmup\n\
+     */\n\
+    for (;;) {\n\
+        t0 = now_ns();\n\
+        fn(arg, iters);\n\
+        if (now_ns() - t0 >= BENCH_MIN_SAMPLE_NS || iters >= (1ull << 40)) {\n\
+            break;\n\
+        }\n\
+        iters *= 2;\n\
+    }\n\
+    r->iters = iters;\n\
+\n\
+    start = now_ns();\n\
+    while (n < BENCH_MAX_SAMPLES) {\n\
+        t0 = now_ns();\n\
+        fn(arg, iters);\n\
+        s[n++] = (double) (now_ns() - t0) / iters;\n\
+        if (n >= BENCH_MIN_SAMPLES) {\n\
+            double *c = malloc(n * sizeof(double));\n\
+            if (c == NULL) {\n\
+                break;\n\
+            }\n\
+            memcpy(c, s, n * sizeof(double));\n\
+            summarize(c, n, r);\n\
+            free(c);\n\
+            if (r->rel_err < target) {\n\
+                r->converged = 1;\n\
+                break;\n\
+            }\n\
+        }\n\
+        if (now_ns() - start > max_ns) {\n\
+            break;\n\
+        }\n\
+    }\n\
+    summarize(s, n, r);\n\
+    r->converged = r->rel_err < target;\n\
+    free(s);\n\
+\n\
+    printf(\"%-28s %12.1f ns/op  mean %.1f +- %.2f%%  %d x %llu%s\\n\", name,\n\
+           r->median, r->mean, 100.0 * r->rel_err, r->samples,\n\
+           (unsigned long long) r->iters, r->converged ? \"\" : \"  (not converged)\");\n\
+    if (write_json(env, name, r) != 0) {\n\
+        fprintf(stderr, \"bench: cannot store result for %s\\n\", name);\n\
+        return -1;\n\
+    }\n\
+    return 0;\n\
+}\n";
+
+
+/* bench/Project_bench.c, unless the archetype has its own */
+static const char BENCH_C[] = "\
+#include <stdint.h>\n\
+#include <stdio.h>\n\
+\n\
+#include \"@PROJECT@_benchenv.h\"\n\
+\n\
+/* Benchmarks for @PROJECT@: each one is a bench_fn running the\n\
+ * operation under test iters times. Results land in bench/results.\n\
+ */\n\
+\n\
+static void example(void *arg, uint64_t iters) {\n\
+    volatile uint64_t *acc = arg;\n\
+    for (uint64_t i = 0; i < iters; i++) {\n\
+        *acc += i;\n\
+    }\n\
+}\n\
+\n\
+int main(void) {\n\
+    struct benchenv env;\n\
+    struct bench_result r;\n\
+    uint64_t acc = 0;\n\
+\n\
+    if (benchenv_setup(&env) != 0) {\n\
+        return 1;\n\
+    }\n\
+    return bench_run(&env, \"example\", example, &acc, &r) != 0;\n\
+}\n";
+
+
+/* Appended to the generated Makefile */
+static const char BENCH_MAKE[] = "\
+\n\
+\n\
+# make bench: runs bench/@PROJECT@_bench pinned and with the machine\n\
+# state checked; results go to bench/results/*.json.\n\
+# BENCH_CPUS=2,3 picks CPUs, BENCH_STRICT=1 refuses noisy machines\n\
+BENCH_ARGS=\n\
+BENCH_CFLAGS=-O2 -g -Wall -pthread -Ilib -Ibench\n\
+\n\
+build/@PROJECT@_bench: bench/@PROJECT@_bench.c bench/@PROJECT@_benchenv.c lib/@PROJECT@.c\n\
+	@mkdir -p build\n\
+	$(CC) -o $@ bench/@PROJECT@_bench.c bench/@PROJECT@_benchenv.c lib/@PROJECT@.c $(COMPONENT_SRC) \\\n\
+		$(BENCH_CFLAGS) $(COMPONENT_CFLAGS) $(LIBS) -lm\n\
+\n\
+.PHONY: bench\n\
+\n\
+bench: build/@PROJECT@_bench\n\
+	./build/@PROJECT@_bench $(BENCH_ARGS)\n";
+
+
+#endif
@@ -0,0 +1,522 @@
+/*
+ * Templates for the lockprof component: drop-in pthread mutex and
+ *      rwlock wrappers recording wait and hold time histograms per
+ *      lock site, compiled out unless built with LOCKPROF=1.
+ */
+
+#ifndef TMPL_LOCKPROF_H
+#define TMPL_LOCKPROF_H
+
+/* lib/Project_lockprof.h */
+static const char LOCKPROF_H[] = "\
+#ifndef @GUARD@_LOCKPROF_H\n\
+#define @GUARD@_LOCKPROF_H\n\
+\n\
+/* Lock contention profiling: drop-in wrappers for pthread mutexes and\n\
+ * rwlocks that record wait and hold time histograms per lock site.\n\
+ * Without -DLOCKPROF every wrapper is the plain pthread call.\n\
+ *\n\
+ *      lp_mutex_t m = LP_MUTEX_INITIALIZER;\n\
+ *      lp_mutex_lock(&m);          site is this file:line\n\
+ *      lp_mutex_unlock(&m);\n\
+ *\n\
+ * Uncontended acquisitions take the trylock fast path and only time\n\
+ * the hold on one acquisition in LP_HOLD_SAMPLE; contended ones are\n\
+ * always timed. The report is written at exit to $LOCKPROF_OUT, or\n\
+ * stderr; LOCKPROF_HIST=1 adds every site's wait and hold histograms.\n\
+ */\n\
+\n\
+#include <pthread.h>\n\
+\n\
+#ifdef LOCKPROF\n\
+\n\
+#include <errno.h>\n\
+#include <stdint.h>\n\
+#include <time.h>\n\
+\n\
+#define LP_BUCKETS 40\n\
+#define LP_HOLD_SAMPLE 64\n\
+#define LP_MAX_SITES 512\n\
+\n\
+/* The first line is read on every acquisition and written once; the\n\
+ * counters below it are only touched on contention or a sampled hold.\n\
+ * Plain acquisitions are counted per thread, see lp_count.\n\
+ */\n\
+struct lp_site {\n\
+    const char *file;\n\
+    int line;\n\
+    const char *name;\n\
+    struct lp_site *next;\n\
+    int registered;\n\
+    unsigned id;\n\
+    uint64_t acquires __attribute__((aligned(64)));    /* sites past LP_MAX_SITES */\n\
+    uint64_t contended;\n\
+    uint64_t wait_ns;\n\
+    uint64_t wait_max;\n\
+    uint64_t holds;\n\
+    uint64_t hold_ns;\n\
+    uint64_t hold_max;\n\
+    uint64_t wait_hist[LP_BUCKETS];    /* log2 buckets of nanoseconds */\n\
+    uint64_t hold_hist[LP_BUCKETS];\n\
+};\n\
+\n\
+typedef struct {\n\
+    pthread_mutex_t m;\n\
+    struct lp_site *site;\n\
+    uint64_t t0;\n\
+} lp_mutex_t;\n\
+\n\
+/* site and t0 belong to the writer; readers keep theirs per thread */\n\
+typedef struct {\n\
+    pthread_rwlock_t l;\n\
+    struct lp_site *site;\n\
+    uint64_t t0;\n\
+    int wr;\n\
+} lp_rwlock_t;\n\
+\n\
+#define LP_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }\n\
+#define LP_RWLOCK_INITIALIZER { PTHREAD_RWLOCK_INITIALIZER, NULL, 0, 0 }\n\
+\n\
+#define LP_SITE(what) __extension__ ({ \\\n\
+        static struct lp_site lp_site_ = \\\n\
+            { .file = __FILE__, .line = __LINE__, .name = what }; \\\n\
+        &lp_site_; })\n\
+\n\
+extern __thread unsigned lp_tick;\n\
+extern __thread uint64_t *lp_acq;\n\
+\n\
+void lp_register(struct lp_site *s);\n\
+uint64_t *lp_thread_attach(void);\n\
+void lp_record(struct lp_site *s, uint64_t *hist, uint64_t ns, int wait);\n\
+void lp_read_held(const lp_rwlock_t *l, struct lp_site *s, uint64_t t0);\n\
+void lp_read_release(const lp_rwlock_t *l);\n\
+\n\
+static inline uint64_t lp_now(void) {\n\
+    struct timespec ts;\n\
+    clock_gettime(CLOCK_MONOTONIC, &ts);\n\
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;\n\
+}\n\
+\n\
+/* Bumps this thread's count for the site; only the owner writes it,\n\
+ * so a plain add is enough and the report sums every thread's block\n\
+ */\n\
+static inline void lp_count(struct lp_site *s) {\n\
+    uint64_t *c = lp_acq;\n\
+    if (c == NULL) {\n\
+        c = lp_thread_attach();\n\
+    }\n\
+    if (c != NULL && s->id < LP_MAX_SITES) {\n\
+        __atomic_store_n(&c[s->id], __atomic_load_n(&c[s->id], __ATOMIC_RELAXED) + 1,\n\
+                         __ATOMIC_RELAXED);\n\
+    } else {\n\
+        __atomic_fetch_add(&s->acquires, 1, __ATOMIC_RELAXED);\n\
+    }\n\
+}\n\
+\n\
+/* Called with the lock held; returns the hold start, 0 if unsampled */\n\
+static inline uint64_t lp_acquired(struct lp_site *s, uint64_t t_wait) {\n\
+    if (!__atomic_load_n(&s->registered, __ATOMIC_ACQUIRE)) {\n\
+        lp_register(s);\n\
+    }\n\
+    lp_count(s);\n\
+    if (t_wait != 0) {\n\
+        uint64_t now = lp_now();\n\
+        lp_record(s, s->wait_hist, now - t_wait, 1);\n\
+        return now;\n\
+    }\n\
+    return (++lp_tick % LP_HOLD_SAMPLE) == 0 ? lp_now() : 0;\n\
+}\n\
+\n\
+static inline void lp_released(struct lp_site *s, uint64_t t0) {\n\
+    if (t0 != 0) {\n\
+        lp_record(s, s->hold_hist, lp_now() - t0, 0);\n\
+    }\n\
+}\n\
+\n\
+static inline int lp_mutex_lock_at(lp_mutex_t *m, struct lp_site *s) {\n\
+    uint64_t t_wait = 0;\n\
+    int rc = pthread_mutex_trylock(&m->m);\n\
+    if (rc == EBUSY) {\n\
+        t_wait = lp_now();\n\
+        rc = pthread_mutex_lock(&m->m);\n\
+    }\n\
+    if (rc == 0) {\n\
+        m->t0 = lp_acquired(s, t_wait);\n\
+        m->site = s;\n\
+    }\n\
+    return rc;\n\
+}\n\
+\n\
+static inline int lp_mutex_trylock_at(lp_mutex_t *m, struct lp_site *s) {\n\
+    int rc = pthread_mutex_trylock(&m->m);\n\
+    if (rc == 0) {\n\
+        m->t0 = lp_acquired(s, 0);\n\
+        m->site = s;\n\
+    }\n\
+    return rc;\n\
+}\n\
+\n\
+static inline int lp_mutex_unlock_(lp_mutex_t *m) {\n\
+    struct lp_site *s = m->site;\n\
+    uint64_t t0 = m->t0;\n\
+    m->t0 = 0;\n\
+    if (s != NULL) {\n\
+        lp_released(s, t0);\n\
+    }\n\
+    return pthread_mutex_unlock(&m->m);\n\
+}\n\
+\n\
+/* The hold ends while waiting and a new one starts on wakeup */\n\
+static inline int lp_cond_wait_at(pthread_cond_t *c, lp_mutex_t *m,\n\
+                                  struct lp_site *s) {\n\
+    int rc;\n\
+    if (m->site != NULL) {\n\
+        lp_released(m->site, m->t0);\n\
+    }\n\
+    m->t0 = 0;\n\
+    rc = pthread_cond_wait(c, &m->m);\n\
+    m->t0 = lp_acquired(s, 0);\n\
+    m->site = s;\n\
+    return rc;\n\
+}\n\
+\n\
+static inline int lp_rwlock_wrlock_at(lp_rwlock_t *l, struct lp_site *s) {\n\
+    uint64_t t_wait = 0;\n\
+    int rc = pthread_rwlock_trywrlock(&l->l);\n\
+    if (rc == EBUSY) {\n\
+        t_wait = lp_now();\n\
+        rc = pthread_rwlock_wrlock(&l->l);\n\
+    }\n\
+    if (rc == 0) {\n\
+        l->t0 = lp_acquired(s, t_wait);\n\
+        l->site = s;\n\
+        l->wr = 1;\n\
+    }\n\
+    return rc;\n\
+}\n\
+\n\
+static inline int lp_rwlock_rdlock_at(lp_rwlock_t *l, struct lp_site *s) {\n\
+    uint64_t t_wait = 0;\n\
+    int rc = pthread_rwlock_tryrdlock(&l->l);\n\
+    if (rc == EBUSY) {\n\
+        t_wait = lp_now();\n\
+        rc = pthread_rwlock_rdlock(&l->l);\n\
+    }\n\
+    if (rc == 0) {\n\
+        lp_read_held(l, s, lp_acquired(s, t_wait));\n\
+    }\n\
+    return rc;\n\
+}\n\
+\n\
+static inline int lp_rwlock_unlock_(lp_rwlock_t *l) {\n\
+    if (l->wr) {\n\
+        uint64_t t0 = l->t0;\n\
+        l->wr = 0;\n\
+        l->t0 = 0;\n\
+        lp_released(l->site, t0);\n\
+    } else {\n\
+        lp_read_release(l);\n\
+    }\n\
+    return pthread_rwlock_unlock(&l->l);\n\
+}\n\
+\n\
+#define lp_mutex_init(m, attr) pthread_mutex_init(&(m)->m, (attr))\n\
+#define lp_mutex_destroy(m) pthread_mutex_destroy(&(m)->m)\n\
+#define lp_mutex_lock(m) lp_mutex_lock_at((m), LP_SITE(#m))\n\
+#define lp_mutex_trylock(m) lp_mutex_trylock_at((m), LP_SITE(#m))\n\
+#define lp_mutex_unlock(m) lp_mutex_unlock_(m)\n\
+#define lp_cond_wait(c, m) lp_cond_wait_at((c), (m), LP_SITE(#m))\n\
+#define lp_rwlock_init(l, attr) pthread_rwlock_init(&(l)->l, (attr))\n\
+#define lp_rwlock_destroy(l) pthread_rwlock_destroy(&(l)->l)\n\
+#define lp_rwlock_rdlock(l) lp_rwlock_rdlock_at((l), LP_SITE(#l))\n\
+#define lp_rwlock_wrlock(l) lp_rwlock_wrlock_at((l), LP_SITE(#l))\n\
+#define lp_rwlock_unlock(l) lp_rwlock_unlock_(l)\n\
+\n\
+#else\n\
+\n\
+typedef pthread_mutex_t lp_mutex_t;\n\
+typedef pthread_rwlock_t lp_rwlock_t;\n\
+\n\
+#define LP_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER\n\
+#define LP_RWLOCK_INITIALIZER PTHREAD_RWLOCK_INITIALIZER\n\
+\n\
+#define lp_mutex_init pthread_mutex_init\n\
+#define lp_mutex_destroy pthread_mutex_destroy\n\
+#define lp_mutex_lock pthread_mutex_lock\n\
+#define lp_mutex_trylock pthread_mutex_trylock\n\
+#define lp_mutex_unlock pthread_mutex_unlock\n\
+#define lp_cond_wait pthread_cond_wait\n\
+#define lp_rwlock_init pthread_rwlock_init\n\
+#define lp_rwlock_destroy pthread_rwlock_destroy\n\
+#define lp_rwlock_rdlock pthread_rwlock_rdlock\n\
+#define lp_rwlock_wrlock pthread_rwlock_wrlock\n\
+#define lp_rwlock_unlock pthread_rwlock_unlock\n\
+\n\
+#endif\n\
+\n\
+#endif\n";
+
+
+/* lib/Project_lockprof.c */
+static const char LOCKPROF_C[] = "\
+#include \"@PROJECT@_lockprof.h\"\n\
+\n\
+#ifdef LOCKPROF\n\
+\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+\n\
+#define LP_READ_SLOTS 16\n\
+\n\
+struct lp_read {\n\
+    const lp_rwlock_t *lock;\n\
+    struct lp_site *site;\n\
+    uint64_t t0;\n\
+};\n\
+\n\
+/* Per-thread acquisition counts, indexed by site id. A block outlives\n\
+ * its thread: on exit it goes on a free list and the next new thread\n\
+ * keeps counting into it, so nothing is lost and blocks are bounded by\n\
+ * the peak thread count.\n\
+ */\n\
+struct lp_counts {\n\
+    uint64_t acquires[LP_MAX_SITES];\n\
+    struct lp_counts *all_next;\n\
+    struct lp_counts *free_next;\n\
+};\n\
+\n\
+__thread unsigned lp_tick;\n\
+__thread uint64_t *lp_acq;\n\
+static __thread struct lp_read lp_reads[LP_READ_SLOTS];\n\
+static __thread unsigned lp_nreads;\n\
+static struct lp_site *lp_sites;\n\
+static unsigned lp_nsites;\n\
+static struct lp_counts *lp_blocks, *lp_free;\n\
+static pthread_mutex_t lp_lock = PTHREAD_MUTEX_INITIALIZER;\n\
+static pthread_key_t lp_key;\n\
+static pthread_once_t lp_key_once = PTHREAD_ONCE_INIT;\n\
+\n\
+/* The id is set before registered is published, so lp_count never\n\
+ * sees a registered site without its slot\n\
+ */\n\
+void lp_register(struct lp_site *s) {\n\
+    pthread_mutex_lock(&lp_lock);\n\
+    if (!s->registered) {\n\
+        s->id = lp_nsites++;\n\
+        s->next = lp_sites;\n\
+        lp_sites = s;\n\
+        __atomic_store_n(&s->registered, 1, __ATOMIC_RELEASE);\n\
+    }\n\
+    pthread_mutex_unlock(&lp_lock);\n\
+}\n\
+\n\
+static void lp_thread_detach(void *block) {\n\
+    struct lp_counts *b = block;\n\
+    pthread_mutex_lock(&lp_lock);\n\
+    b->free_next = lp_free;\n\
+    lp_free = b;\n\
+    pthread_mutex_unlock(&lp_lock);\n\
+}\n\
+\n\
+static void lp_key_init(void) {\n\
+    pthread_key_create(&lp_key, lp_thread_detach);\n\
+}\n\
+\n\
+uint64_t *lp_thread_attach(void) {\n\
+    struct lp_counts *b;\n\
+\n\
+    pthread_once(&lp_key_once, lp_key_init);\n\
+    pthread_mutex_lock(&lp_lock);\n\
+    if ((b = lp_free) != NULL) {\n\
+        lp_free = b->free_next;\n\
+    } else if ((b = calloc(1, sizeof(*b))) != NULL) {\n\
+        b->all_next = lp_blocks;\n\
+        lp_blocks = b;\n\
+    }\n\
+    pthread_mutex_unlock(&lp_lock);\n\
+    if (b != NULL) {\n\
+        pthread_setspecific(lp_key, b);\n\
+        lp_acq = b->acquires;\n\
+    }\n\
+    return lp_acq;\n\
+}\n\
+\n\
+static unsigned lp_bucket(uint64_t ns) {\n\
+    unsigned b = ns == 0 ? 0 : 64 - __builtin_clzll(ns);\n\
+    return b < LP_BUCKETS ? b : LP_BUCKETS - 1;\n\
+}\n\
+\n\
+static void lp_max(uint64_t *max, uint64_t v) {\n\
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);\n\
+    while (v > cur && !__atomic_compare_exchange_n(max, &cur, v, 1,\n\
+                                                   __ATOMIC_RELAXED,\n\
+                                                   __ATOMIC_RELAXED)) {\n\
+    }\n\
+}\n\
+\n\
+void lp_record(struct lp_site *s, uint64_t *hist, uint64_t ns, int wait) {\n\
+    __atomic_fetch_add(&hist[lp_bucket(ns)], 1, __ATOMIC_RELAXED);\n\
+    if (wait) {\n\
+        __atomic_fetch_add(&s->contended, 1, __ATOMIC_RELAXED);\n\
+        __atomic_fetch_add(&s->wait_ns, ns, __ATOMIC_RELAXED);\n\
+        lp_max(&s->wait_max, ns);\n\
+    } else {\n\
+        __atomic_fetch_add(&s->holds, 1, __ATOMIC_RELAXED);\n\
+        __atomic_fetch_add(&s->hold_ns, ns, __ATOMIC_RELAXED);\n\
+        lp_max(&s->hold_max, ns);\n\
+    }\n\
+}\n\
+\n\
+void lp_read_held(const lp_rwlock_t *l, struct lp_site *s, uint64_t t0) {\n\
+    if (t0 != 0 && lp_nreads < LP_READ_SLOTS) {\n\
+        lp_reads[lp_nreads].lock = l;\n\
+        lp_reads[lp_nreads].site = s;\n\
+        lp_reads[lp_nreads].t0 = t0;\n\
+        lp_nreads++;\n\
+    }\n\
+}\n\
+\n\
+void lp_read_release(const lp_rwlock_t *l) {\n\
+    for (unsigned i = lp_nreads; i > 0; i--) {\n\
+        if (lp_reads[i - 1].lock == l) {\n\
+            lp_released(lp_reads[i - 1].site, lp_reads[i - 1].t0);\n\
+            lp_reads[i - 1] = lp_reads[--lp_nreads];\n\
+            return;\n\
+        }\n\
+    }\n\
+}\n\
+\n\
+/* Upper bound of the bucket holding the q-th quantile */\n\
+static uint64_t lp_quantile(const uint64_t *hist, double q) {\n\
+    uint64_t total = 0, seen = 0;\n\
+    for (unsigned b = 0; b < LP_BUCKETS; b++) {\n\
+        total += hist[b];\n\
+    }\n\
+    if (total == 0) {\n\
+        return 0;\n\
+    }\n\
+    for (unsigned b = 0; b < LP_BUCKETS; b++) {\n\
+        seen += hist[b];\n\
+        if (seen >= q * total) {\n\
+            return (uint64_t) 1 << b;\n\
+        }\n\
+    }\n\
+    return (uint64_t) 1 << (LP_BUCKETS - 1);\n\
+}\n\
+\n\
+/* One line per histogram: \"<=UPPER:count\" for every non-empty bucket */\n\
+static void lp_hist_line(FILE *out, const char *what, const uint64_t *hist) {\n\
+    fprintf(out, \"  %-5s\", what);\n\
+    for (unsigned b = 0; b < LP_BUCKETS; b++) {\n\
+        if (hist[b] != 0) {\n\
+            fprintf(out, \" <=%lluns:%llu\", (unsigned long long) 1 << b,\n\
+                    (unsigned long long) hist[b]);\n\
+        }\n\
+    }\n\
+    fputc('\\n', out);\n\
+}\n\
+\n\
+static int lp_by_wait(const void *a, const void *b) {\n\
+    const struct lp_site *x = *(struct lp_site *const *) a;\n\
+    const struct lp_site *y = *(struct lp_site *const *) b;\n\
+    return (x->wait_ns < y->wait_ns) - (x->wait_ns > y->wait_ns);\n\
+}\n\
+\n\
+__attribute__((destructor))\n\
+static void lp_report(void) {\n\
+    const char *path = getenv(\"LOCKPROF_OUT\");\n\
+    struct lp_site **sorted, *s;\n\
+    size_t n = 0;\n\
+    FILE *out = stderr;\n\
+\n\
+    pthread_mutex_lock(&lp_lock);\n\
+    for (s = lp_sites; s != NULL; s = s->next) {\n\
+        n++;\n\
+    }\n\
+    if (n == 0 || (sorted = malloc(n * sizeof(*sorted))) == NULL) {\n\
+        pthread_mutex_unlock(&lp_lock);\n\
+        return;\n\
+    }\n\
+    n = 0;\n\
+    for (s = lp_sites; s != NULL; s = s->next) {\n\
+        sorted[n++] = s;\n\
+    }\n\
+    pthread_mutex_unlock(&lp_lock);\n\
+    /* Fold the per-thread counts into the sites before sorting */\n\
+    pthread_mutex_lock(&lp_lock);\n\
+    for (struct lp_counts *b = lp_blocks; b != NULL; b = b->all_next) {\n\
+        for (size_t i = 0; i < n; i++) {\n\
+            if (sorted[i]->id < LP_MAX_SITES) {\n\
+                sorted[i]->acquires += __atomic_load_n(&b->acquires[sorted[i]->id],\n\
+                                                       __ATOMIC_RELAXED);\n\
+            }\n\
+        }\n\
+    }\n\
+    pthread_mutex_unlock(&lp_lock);\n\
+    qsort(sorted, n, sizeof(*sorted), lp_by_wait);\n\
+    if (path != NULL && *path != '\\0' && (out = fopen(path, \"w\")) == NULL) {\n\
+        out = stderr;\n\
+    }\n\
+\n\
+    fprintf(out, \"lockprof: %zu lock sites, sorted by total wait\\n\", n);\n\
+    fprintf(out, \"%-32s %10s %7s %12s %10s %10s %10s %10s\\n\",\n\
+            \"site\", \"acquires\", \"cont%\", \"wait ms\", \"wait p50\", \"wait p99\",\n\
+            \"hold p50\", \"hold p99\");\n\
+    for (size_t i = 0; i < n; i++) {\n\
+        char where[256];\n\
+        const char *file = strrchr(sorted[i]->file, '/');\n\
+        s = sorted[i];\n\
+        snprintf(where, sizeof(where), \"%s:%d %s\",\n\
+                 file != NULL ? file + 1 : s->file, s->line, s->name);\n\
+        fprintf(out, \"%-32s %10llu %6.2f%% %12.3f %8lluns %8lluns %8lluns %8lluns\\n\",\n\
+                where, (unsigned long long) s->acquires,\n\
+                s->acquires ? 100.0 * s->contended / s->acquires : 0.0,\n\
+                s->wait_ns / 1e6,\n\
+                (unsigned long long) lp_quantile(s->wait_hist, 0.5),\n\
+                (unsigned long long) lp_quantile(s->wait_hist, 0.99),\n\
+                (unsigned long long) lp_quantile(s->hold_hist, 0.5),\n\
+                (unsigned long long) lp_quantile(s->hold_hist, 0.99));\n\
+    }\n\
+    fprintf(out, \"(percentiles are log2 bucket upper bounds; holds are sampled\"\n\
+            \" 1 in %d when uncontended)\\n\", LP_HOLD_SAMPLE);\n\
+    /* LOCKPROF_HIST=1: the full wait and hold histograms per site */\n\
+    if (getenv(\"LOCKPROF_HIST\") != NULL && atoi(getenv(\"LOCKPROF_HIST\")) != 0) {\n\
+        fprintf(out, \"\\nlog2 histograms, bucket upper bound:count\\n\");\n\
+        for (size_t i = 0; i < n; i++) {\n\
+            const char *file = strrchr(sorted[i]->file, '/');\n\
+            s = sorted[i];\n\
+            fprintf(out, \"%s:%d %s\\n\", file != NULL ? file + 1 : s->file, s->line, s->name);\n\
+            lp_hist_line(out, \"wait\", s->wait_hist);\n\
+            lp_hist_line(out, \"hold\", s->hold_hist);\n\
+        }\n\
+    }\n\
+    if (out != stderr) {\n\
+        fclose(out);\n\
+    }\n\
+    free(sorted);\n\
+}\n\
+\n\
+#else\n\
+\n\
+/* Keeps the translation unit non-empty when profiling is compiled out */\n\
+typedef int lp_disabled;\n\
+\n\
+#endif\n";
+
+
+/* Appended to the generated Makefile */
+static const char LOCKPROF_MAKE[] = "\
+\n\
+\n\
+# lockprof component: lock wrappers in lib/@PROJECT@_lockprof.h.\n\
+# make LOCKPROF=1 compiles the profiling in; otherwise they are\n\
+# plain pthread calls and cost nothing\n\
+COMPONENT_SRC += lib/@PROJECT@_lockprof.c\n\
+COMPONENT_CFLAGS += -pthread\n\
+ifdef LOCKPROF\n\
+COMPONENT_CFLAGS += -DLOCKPROF\n\
+endif\n";
+
+
+#endif
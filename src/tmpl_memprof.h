@@ -0,0 +1,562 @@
+/*
+ * Templates for the memprof tool generated into every project: an
+ *      LD_PRELOAD malloc-interposition shim that aggregates allocation
+ *      count, bytes and peak live bytes per call stack and writes a
+ *      sorted report plus folded stacks for flame graphs.
+ */
+
+#ifndef TMPL_MEMPROF_H
+#define TMPL_MEMPROF_H
+
+/* tools/Project_memprof.c */
+static const char MEMPROF_C[] = "\
+/*\n\
+ * memprof: LD_PRELOAD allocation profiler for @PROJECT@\n\
+ *\n\
+ * Interposes the malloc family, attributes every allocation to its\n\
+ * call stack (frame-pointer unwinding, so build the target with\n\
+ * -fno-omit-frame-pointer) and at exit writes\n\
+ *      $MEMPROF_OUT.txt     stacks sorted by bytes allocated\n\
+ *      $MEMPROF_OUT.folded  folded stacks for flamegraph.pl\n\
+ *\n\
+ * Each block carries a 16 byte header with its size and stack, so\n\
+ * free() needs no lookup table. Environment:\n\
+ *      MEMPROF_OUT    output prefix (default \"memprof\")\n\
+ *      MEMPROF_TOP    stacks listed in the report (default 50)\n\
+ *      MEMPROF_DEPTH  frames kept per stack (default and max 24)\n\
+ */\n\
+#define _GNU_SOURCE\n\
+#include <dlfcn.h>\n\
+#include <errno.h>\n\
+#include <pthread.h>\n\
+#include <stdint.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <sys/mman.h>\n\
+#include <unistd.h>\n\
+\n\
+#define MP_MAX_DEPTH 24\n\
+#define MP_TABLE_BITS 16\n\
+#define MP_TABLE_SIZE (1u << MP_TABLE_BITS)\n\
+#define MP_HDR 16\n\
+#define MP_UNTRACKED UINT32_MAX\n\
+#define MP_BOOT_SIZE (64 * 1024)\n\
+\n\
+#define MP_TLS __thread __attribute__((tls_model(\"initial-exec\")))\n\
+\n\
+struct mp_hdr {\n\
+    size_t size;\n\
+    uint32_t stack;\n\
+    uint32_t offset;    /* from the block returned by libc to the user pointer */\n\
+};\n\
+\n\
+struct mp_stack {\n\
+    int state;          /* 0 empty, 1 being filled, 2 ready */\n\
+    uint32_t depth;\n\
+    uint64_t hash;\n\
+    uint64_t allocs;\n\
+    uint64_t bytes;\n\
+    int64_t live;\n\
+    int64_t peak;\n\
+    void *frames[MP_MAX_DEPTH];\n\
+};\n\
+\n\
+static void *(*real_malloc)(size_t);\n\
+static void (*real_free)(void *);\n\
+static void *(*real_calloc)(size_t, size_t);\n\
+static void *(*real_realloc)(void *, size_t);\n\
+\n\
+static struct mp_stack *table;\n\
+static unsigned max_depth = MP_MAX_DEPTH;\n\
+static int64_t live_total, peak_total;\n\
+static uint64_t allocs_total, bytes_total;\n\
+\n\
+static char boot[MP_BOOT_SIZE] __attribute__((aligned(16)));\n\
+static size_t boot_used;\n\
+static int initializing;\n\
+\n\
+static MP_TLS int in_hook;\n\
+static MP_TLS uintptr_t stack_lo, stack_hi;\n\
+\n\
+static int is_boot(const void *p) {\n\
+    return (const char *) p >= boot && (const char *) p < boot + MP_BOOT_SIZE;\n\
+}\n\
+\n\
+/* dlsym() may allocate before the real functions are known */\n\
+static void *boot_alloc(size_t size) {\n\
+    size_t at = __atomic_fetch_add(&boot_used, (size + 15) & ~(size_t) 15,\n\
+                                   __ATOMIC_RELAXED);\n\
+    if (at + size > MP_BOOT_SIZE) {\n\
+        return NULL;\n\
+    }\n\
+    return boot + at;\n\
+}\n\
+\n\
+static void mp_init(void) {\n\
+    const char *env;\n\
+    if (real_malloc != NULL || initializing) {\n\
+        return;\n\
+    }\n\
+    initializing = 1;\n\
+    real_malloc = dlsym(RTLD_NEXT, \"malloc\");\n\
+    real_free = dlsym(RTLD_NEXT, \"free\");\n\
+    real_calloc = dlsym(RTLD_NEXT, \"calloc\");\n\
+    real_realloc = dlsym(RTLD_NEXT, \"realloc\");\n\
+    table = mmap(NULL, MP_TABLE_SIZE * sizeof(*table), PROT_READ | PROT_WRITE,\n\
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);\n\
+    if (table == MAP_FAILED) {\n\
+        table = NULL;\n\
+    }\n\
+    if ((env = getenv(\"MEMPROF_DEPTH\")) != NULL && atoi(env) > 0 &&\n\
+            atoi(env) < MP_MAX_DEPTH) {\n\
+        max_depth = atoi(env);\n\
+    }\n\
+    initializing = 0;\n\
+}\n\
+\n\
+/* Bounds of this thread's stack, so a frame chain through code built\n\
+ * without frame pointers is cut off instead of followed off a cliff.\n\
+ */\n\
+static void stack_bounds(void) {\n\
+    pthread_attr_t attr;\n\
+    void *addr;\n\
+    size_t size;\n\
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {\n\
+        if (pthread_attr_getstack(&attr, &addr, &size) == 0) {\n\
+            stack_lo = (uintptr_t) addr;\n\
+            stack_hi = (uintptr_t) addr + size;\n\
+        }\n\
+        pthread_attr_destroy(&attr);\n\
+    }\n\
+    if (stack_hi == 0) {\n\
+        stack_lo = 1;\n\
+        stack_hi = 1;\n\
+    }\n\
+}\n\
+\n\
+/* fp is the frame of the public hook, so frames[0] is its caller */\n\
+static unsigned unwind(void **frames, uintptr_t *fp) {\n\
+    unsigned n = 0;\n\
+    if (stack_hi == 0) {\n\
+        stack_bounds();\n\
+    }\n\
+    while (n < max_depth) {\n\
+        uintptr_t *next;\n\
+        if ((uintptr_t) fp < stack_lo || (uintptr_t) fp + 16 > stack_hi ||\n\
+                ((uintptr_t) fp & 7) != 0) {\n\
+            break;\n\
+        }\n\
+        if (fp[1] == 0) {\n\
+            break;\n\
+        }\n\
+        frames[n++] = (void *) fp[1];\n\
+        next = (uintptr_t *) fp[0];\n\
+        if (next <= fp) {\n\
+            break;\n\
+        }\n\
+        fp = next;\n\
+    }\n\
+    return n;\n\
+}\n\
+\n\
+static uint32_t stack_id(void *fp) {\n\
+    void *frames[MP_MAX_DEPTH];\n\
+    unsigned depth, i;\n\
+    uint64_t h = 1469598103934665603ull;\n\
+\n\
+    if (table == NULL) {\n\
+        return MP_UNTRACKED;\n\
+    }\n\
+    depth = unwind(frames, fp);\n\
+    for (i = 0; i < depth; i++) {\n\
+        h = (h ^ (uintptr_t) frames[i]) * 1099511628211ull;\n\
+    }\n\
+    h ^= h >> 29;\n\
+    for (i = 0; i < MP_TABLE_SIZE; i++) {\n\
+        uint32_t idx = (uint32_t) (h + i) & (MP_TABLE_SIZE - 1);\n\
+        struct mp_stack *s = &table[idx];\n\
+        int state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);\n\
+        if (state == 0) {\n\
+            int expect = 0;\n\
+            if (__atomic_compare_exchange_n(&s->state, &expect, 1, 0,\n\
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {\n\
+                s->depth = depth;\n\
+                s->hash = h;\n\
+                memcpy(s->frames, frames, depth * sizeof(void *));\n\
+                __atomic_store_n(&s->state, 2, __ATOMIC_RELEASE);\n\
+                return idx;\n\
+            }\n\
+            state = expect;\n\
+        }\n\
+        while (state == 1) {\n\
+            state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);\n\
+        }\n\
+        if (s->hash == h && s->depth == depth &&\n\
+                memcmp(s->frames, frames, depth * sizeof(void *)) == 0) {\n\
+            return idx;\n\
+        }\n\
+    }\n\
+    return MP_UNTRACKED;\n\
+}\n\
+\n\
+static void max_update(int64_t *peak, int64_t v) {\n\
+    int64_t cur = __atomic_load_n(peak, __ATOMIC_RELAXED);\n\
+    while (v > cur && !__atomic_compare_exchange_n(peak, &cur, v, 1,\n\
+                                                   __ATOMIC_RELAXED,\n\
+                                                   __ATOMIC_RELAXED)) {\n\
+    }\n\
+}\n\
+\n\
+static void account(struct mp_hdr *h, size_t size, void *fp) {\n\
+    h->size = size;\n\
+    h->stack = MP_UNTRACKED;\n\
+    if (in_hook) {\n\
+        return;\n\
+    }\n\
+    in_hook = 1;\n\
+    h->stack = stack_id(fp);\n\
+    __atomic_fetch_add(&allocs_total, 1, __ATOMIC_RELAXED);\n\
+    __atomic_fetch_add(&bytes_total, size, __ATOMIC_RELAXED);\n\
+    max_update(&peak_total, __atomic_add_fetch(&live_total, (int64_t) size,\n\
+                                               __ATOMIC_RELAXED));\n\
+    if (h->stack != MP_UNTRACKED) {\n\
+        struct mp_stack *s = &table[h->stack];\n\
+        __atomic_fetch_add(&s->allocs, 1, __ATOMIC_RELAXED);\n\
+        __atomic_fetch_add(&s->bytes, size, __ATOMIC_RELAXED);\n\
+        max_update(&s->peak, __atomic_add_fetch(&s->live, (int64_t) size,\n\
+                                                __ATOMIC_RELAXED));\n\
+    }\n\
+    in_hook = 0;\n\
+}\n\
+\n\
+static void unaccount(struct mp_hdr *h) {\n\
+    if (h->stack == MP_UNTRACKED) {\n\
+        return;\n\
+    }\n\
+    __atomic_fetch_sub(&live_total, (int64_t) h->size, __ATOMIC_RELAXED);\n\
+    __atomic_fetch_sub(&table[h->stack].live, (int64_t) h->size,\n\
+                       __ATOMIC_RELAXED);\n\
+}\n\
+\n\
+static struct mp_hdr *hdr_of(void *p) {\n\
+    return (struct mp_hdr *) ((char *) p - MP_HDR);\n\
+}\n\
+\n\
+static void *finish(char *base, size_t off, size_t size, void *fp) {\n\
+    struct mp_hdr *h;\n\
+    if (base == NULL) {\n\
+        return NULL;\n\
+    }\n\
+    h = (struct mp_hdr *) (base + off - MP_HDR);\n\
+    h->offset = (uint32_t) off;\n\
+    account(h, size, fp);\n\
+    return base + off;\n\
+}\n\
+\n\
+#define HOOK_FP __builtin_frame_address(0)\n\
+\n\
+static void *mp_malloc(size_t size, void *fp) {\n\
+    if (real_malloc == NULL) {\n\
+        mp_init();\n\
+        if (real_malloc == NULL) {\n\
+            return boot_alloc(size);\n\
+        }\n\
+    }\n\
+    if (size > SIZE_MAX - MP_HDR) {\n\
+        errno = ENOMEM;\n\
+        return NULL;\n\
+    }\n\
+    return finish(real_malloc(size + MP_HDR), MP_HDR, size, fp);\n\
+}\n\
+\n\
+void *malloc(size_t size) {\n\
+    return mp_malloc(size, HOOK_FP);\n\
+}\n\
+\n\
+void free(void *p) {\n\
+    struct mp_hdr *h;\n\
+    if (p == NULL || is_boot(p)) {\n\
+        return;\n\
+    }\n\
+    h = hdr_of(p);\n\
+    unaccount(h);\n\
+    real_free((char *) p - h->offset);\n\
+}\n\
+\n\
+void *calloc(size_t n, size_t size) {\n\
+    size_t total;\n\
+    if (__builtin_mul_overflow(n, size, &total) || total > SIZE_MAX - MP_HDR) {\n\
+        errno = ENOMEM;\n\
+        return NULL;\n\
+    }\n\
+    if (real_calloc == NULL) {\n\
+        mp_init();\n\
+        if (real_calloc == NULL) {\n\
+            return boot_alloc(total);   /* static storage is already zero */\n\
+        }\n\
+    }\n\
+    return finish(real_calloc(1, total + MP_HDR), MP_HDR, total, HOOK_FP);\n\
+}\n\
+\n\
+static void *mp_realloc(void *p, size_t size, void *fp) {\n\
+    struct mp_hdr *h;\n\
+    char *base;\n\
+    if (p == NULL) {\n\
+        return mp_malloc(size, fp);\n\
+    }\n\
+    if (size == 0) {\n\
+        free(p);\n\
+        return NULL;\n\
+    }\n\
+    if (size > SIZE_MAX - MP_HDR) {\n\
+        errno = ENOMEM;\n\
+        return NULL;\n\
+    }\n\
+    h = hdr_of(p);\n\
+    if (is_boot(p) || h->offset != MP_HDR) {\n\
+        /* Boot and over-aligned blocks cannot be grown by libc */\n\
+        void *q = mp_malloc(size, fp);\n\
+        if (q != NULL) {\n\
+            size_t old = is_boot(p) ? (size_t) (boot + MP_BOOT_SIZE - (char *) p)\n\
+                                    : h->size;\n\
+            memcpy(q, p, old < size ? old : size);\n\
+            free(p);\n\
+        }\n\
+        return q;\n\
+    }\n\
+    struct mp_hdr saved = *h;\n\
+    base = real_realloc((char *) p - MP_HDR, size + MP_HDR);\n\
+    if (base == NULL) {\n\
+        return NULL;\n\
+    }\n\
+    unaccount(&saved);\n\
+    return finish(base, MP_HDR, size, fp);\n\
+}\n\
+\n\
+void *realloc(void *p, size_t size) {\n\
+    return mp_realloc(p, size, HOOK_FP);\n\
+}\n\
+\n\
+static void *aligned(size_t align, size_t size, void *fp) {\n\
+    size_t off;\n\
+    char *base;\n\
+    if (align <= MP_HDR) {\n\
+        return mp_malloc(size, fp);\n\
+    }\n\
+    if ((align & (align - 1)) != 0 || size > SIZE_MAX - align - MP_HDR) {\n\
+        errno = EINVAL;\n\
+        return NULL;\n\
+    }\n\
+    if (real_malloc == NULL) {\n\
+        mp_init();\n\
+    }\n\
+    base = real_malloc(size + align + MP_HDR);\n\
+    if (base == NULL) {\n\
+        return NULL;\n\
+    }\n\
+    off = ((uintptr_t) base + MP_HDR + align - 1) / align * align - (uintptr_t) base;\n\
+    return finish(base, off, size, fp);\n\
+}\n\
+\n\
+int posix_memalign(void **out, size_t align, size_t size) {\n\
+    void *p;\n\
+    if (align < sizeof(void *) || (align & (align - 1)) != 0) {\n\
+        return EINVAL;\n\
+    }\n\
+    p = aligned(align, size, HOOK_FP);\n\
+    if (p == NULL) {\n\
+        return ENOMEM;\n\
+    }\n\
+    *out = p;\n\
+    return 0;\n\
+}\n\
+\n\
+void *aligned_alloc(size_t align, size_t size) {\n\
+    return aligned(align, size, HOOK_FP);\n\
+}\n\
+\n\
+void *memalign(size_t align, size_t size) {\n\
+    return aligned(align, size, HOOK_FP);\n\
+}\n\
+\n\
+void *valloc(size_t size) {\n\
+    return aligned(sysconf(_SC_PAGESIZE), size, HOOK_FP);\n\
+}\n\
+\n\
+void *pvalloc(size_t size) {\n\
+    size_t page = sysconf(_SC_PAGESIZE);\n\
+    return aligned(page, (size + page - 1) / page * page, HOOK_FP);\n\
+}\n\
+\n\
+void *reallocarray(void *p, size_t n, size_t size) {\n\
+    size_t total;\n\
+    if (__builtin_mul_overflow(n, size, &total)) {\n\
+        errno = ENOMEM;\n\
+        return NULL;\n\
+    }\n\
+    return mp_realloc(p, total, HOOK_FP);\n\
+}\n\
+\n\
+size_t malloc_usable_size(void *p) {\n\
+    return p == NULL || is_boot(p) ? 0 : hdr_of(p)->size;\n\
+}\n\
+\n\
+\n\
+/* Report */\n\
+\n\
+static int by_bytes(const void *a, const void *b) {\n\
+    const struct mp_stack *x = *(struct mp_stack *const *) a;\n\
+    const struct mp_stack *y = *(struct mp_stack *const *) b;\n\
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);\n\
+}\n\
+\n\
+struct mp_folded {\n\
+    char *stack;\n\
+    uint64_t bytes;\n\
+};\n\
+\n\
+static int by_stack(const void *a, const void *b) {\n\
+    return strcmp(((const struct mp_folded *) a)->stack,\n\
+                  ((const struct mp_folded *) b)->stack);\n\
+}\n\
+\n\
+/* With offsets every call site is its own frame, as the .txt report\n\
+ * wants; flame graphs need one frame per function so stacks merge\n\
+ */\n\
+static void frame_name(char *dst, size_t cap, void *addr, int offsets) {\n\
+    Dl_info info;\n\
+    /* Return addresses point past the call; look up the call itself */\n\
+    void *pc = (char *) addr - 1;\n\
+    if (dladdr(pc, &info) != 0 && info.dli_sname != NULL) {\n\
+        snprintf(dst, cap, offsets ? \"%s+0x%lx\" : \"%s\", info.dli_sname,\n\
+                 (unsigned long) ((char *) pc - (char *) info.dli_saddr));\n\
+    } else if (info.dli_fname != NULL) {\n\
+        const char *mod = strrchr(info.dli_fname, '/');\n\
+        snprintf(dst, cap, offsets ? \"%s+0x%lx\" : \"%s\",\n\
+                 mod != NULL ? mod + 1 : info.dli_fname,\n\
+                 (unsigned long) ((char *) pc - (char *) info.dli_fbase));\n\
+    } else if (offsets) {\n\
+        snprintf(dst, cap, \"%p\", pc);\n\
+    } else {\n\
+        snprintf(dst, cap, \"[unknown]\");\n\
+    }\n\
+}\n\
+\n\
+__attribute__((destructor))\n\
+static void mp_report(void) {\n\
+    const char *prefix = getenv(\"MEMPROF_OUT\");\n\
+    const char *top_env = getenv(\"MEMPROF_TOP\");\n\
+    size_t top = top_env != NULL ? strtoul(top_env, NULL, 10) : 50;\n\
+    struct mp_stack **sorted;\n\
+    size_t n = 0;\n\
+    char path[4096], name[512];\n\
+    FILE *txt, *folded;\n\
+\n\
+    if (table == NULL) {\n\
+        return;\n\
+    }\n\
+    in_hook = 1;\n\
+    if (prefix == NULL || *prefix == '\\0') {\n\
+        prefix = \"memprof\";\n\
+    }\n\
+    sorted = malloc(MP_TABLE_SIZE * sizeof(*sorted));\n\
+    if (sorted == NULL) {\n\
+        return;\n\
+    }\n\
+    for (size_t i = 0; i < MP_TABLE_SIZE; i++) {\n\
+        if (__atomic_load_n(&table[i].state, __ATOMIC_ACQUIRE) == 2) {\n\
+            sorted[n++] = &table[i];\n\
+        }\n\
+    }\n\
+    qsort(sorted, n, sizeof(*sorted), by_bytes);\n\
+\n\
+    snprintf(path, sizeof(path), \"%s.txt\", prefix);\n\
+    txt = fopen(path, \"w\");\n\
+    snprintf(path, sizeof(path), \"%s.folded\", prefix);\n\
+    folded = fopen(path, \"w\");\n\
+    if (txt != NULL) {\n\
+        fprintf(txt, \"memprof: %llu allocations, %llu bytes, peak live %lld bytes,\"\n\
+                \" %zu distinct stacks\\n\\n\",\n\
+                (unsigned long long) allocs_total, (unsigned long long) bytes_total,\n\
+                (long long) peak_total, n);\n\
+        for (size_t i = 0; i < n && i < top; i++) {\n\
+            struct mp_stack *s = sorted[i];\n\
+            fprintf(txt, \"#%zu  bytes %llu  allocs %llu  peak live %lld\"\n\
+                    \"  leaked %lld\\n\", i + 1,\n\
+                    (unsigned long long) s->bytes, (unsigned long long) s->allocs,\n\
+                    (long long) s->peak, (long long) s->live);\n\
+            for (uint32_t f = 0; f < s->depth; f++) {\n\
+                frame_name(name, sizeof(name), s->frames[f], 1);\n\
+                fprintf(txt, \"    %s\\n\", name);\n\
+            }\n\
+            fputc('\\n', txt);\n\
+        }\n\
+        fclose(txt);\n\
+    }\n\
+    if (folded != NULL) {\n\
+        /* Root first, one line per stack: a;b;c bytes. Stacks that\n\
+         * differ only in call sites become one line.\n\
+         */\n\
+        struct mp_folded *lines = calloc(n ? n : 1, sizeof(*lines));\n\
+        size_t nl = 0;\n\
+        for (size_t i = 0; lines != NULL && i < n; i++) {\n\
+            struct mp_stack *s = sorted[i];\n\
+            char stack[MP_MAX_DEPTH * 128];\n\
+            size_t len = 0;\n\
+            stack[0] = '\\0';\n\
+            for (uint32_t f = s->depth; f > 0 && len < sizeof(stack); f--) {\n\
+                frame_name(name, sizeof(name), s->frames[f - 1], 0);\n\
+                len += (size_t) snprintf(stack + len, sizeof(stack) - len, \"%s%s\",\n\
+                                         name, f > 1 ? \";\" : \"\");\n\
+            }\n\
+            if ((lines[nl].stack = strdup(stack)) != NULL) {\n\
+                lines[nl++].bytes = s->bytes;\n\
+            }\n\
+        }\n\
+        if (lines != NULL) {\n\
+            qsort(lines, nl, sizeof(*lines), by_stack);\n\
+        }\n\
+        for (size_t i = 0; i < nl; i++) {\n\
+            if (i + 1 < nl && strcmp(lines[i].stack, lines[i + 1].stack) == 0) {\n\
+                lines[i + 1].bytes += lines[i].bytes;\n\
+            } else {\n\
+                fprintf(folded, \"%s %llu\\n\", lines[i].stack,\n\
+                        (unsigned long long) lines[i].bytes);\n\
+            }\n\
+            free(lines[i].stack);\n\
+        }\n\
+        free(lines);\n\
+        fclose(folded);\n\
+    }\n\
+    free(sorted);\n\
+}\n";
+
+
+/* Appended to the generated Makefile */
+static const char MEMPROF_MAKE[] = "\
+\n\
+\n\
+# make memprof: allocation profile of @PROJECT@_app through the\n\
+# LD_PRELOAD shim in tools/, no valgrind or heaptrack needed\n\
+MEMPROF_ARGS=\n\
+MEMPROF_OUT=memprof\n\
+MEMPROF_CFLAGS=-O2 -g -fno-omit-frame-pointer -pthread\n\
+\n\
+build/@PROJECT@_memprof.so: tools/@PROJECT@_memprof.c\n\
+	@mkdir -p build\n\
+	$(CC) -shared -fPIC -o $@ $< $(MEMPROF_CFLAGS) -ldl\n\
+\n\
+build/memprof/@PROJECT@_app: src/@PROJECT@_app.c lib/@PROJECT@.c\n\
+	@mkdir -p build/memprof\n\
+	$(CC) -o $@ src/@PROJECT@_app.c lib/@PROJECT@.c $(COMPONENT_SRC) -Ilib -I$(IDIR) \\\n\
+		$(MEMPROF_CFLAGS) $(COMPONENT_CFLAGS) -rdynamic $(LIBS)\n\
+\n\
+.PHONY: memprof\n\
+\n\
+memprof: build/@PROJECT@_memprof.so build/memprof/@PROJECT@_app\n\
+	MEMPROF_OUT=$(MEMPROF_OUT) LD_PRELOAD=./build/@PROJECT@_memprof.so ./build/memprof/@PROJECT@_app $(MEMPROF_ARGS)\n\
+	@echo \"memprof: report in $(MEMPROF_OUT).txt, flame graph input in $(MEMPROF_OUT).folded\"\n";
+
+
+#endif
@@ -0,0 +1,430 @@
+/*
+ * Templates for the metrics component: per-thread sharded counters,
+ *      gauges and log-linear histograms, with a background dumper
+ *      writing Prometheus text format to a file.
+ */
+
+#ifndef TMPL_METRICS_H
+#define TMPL_METRICS_H
+
+/* lib/Project_metrics.h */
+static const char METRICS_H[] = "\
+#ifndef @GUARD@_METRICS_H\n\
+#define @GUARD@_METRICS_H\n\
+\n\
+/* Counters, gauges and log-linear histograms without a metrics\n\
+ * library. Counters and histograms are sharded per thread: the hot\n\
+ * path is a plain add into a thread-local slot array, and readers\n\
+ * merge the shards. Register metrics at startup:\n\
+ *\n\
+ *      static mt_counter reqs;\n\
+ *      reqs = mt_counter_new(\"requests_total\", \"Requests served\");\n\
+ *      mt_inc(reqs);\n\
+ *\n\
+ * metrics_dumper_start() writes Prometheus text format to a file,\n\
+ * atomically replaced every interval.\n\
+ */\n\
+\n\
+#include <stdint.h>\n\
+#include <stdio.h>\n\
+\n\
+#define MT_MAX_METRICS 256\n\
+#define MT_MAX_SLOTS 8192\n\
+#define MT_SUB_BITS 2\n\
+#define MT_SUB (1u << MT_SUB_BITS)\n\
+#define MT_MAX_EXP 40       /* values of 2^40 and up share the last bucket */\n\
+#define MT_HBUCKETS (MT_SUB * (MT_MAX_EXP - MT_SUB_BITS + 1))\n\
+\n\
+typedef struct { unsigned id; } mt_counter;\n\
+typedef struct { unsigned id; } mt_gauge;\n\
+typedef struct { unsigned id; } mt_histogram;   /* buckets, sum, count */\n\
+\n\
+extern __thread uint64_t *mt_slots;\n\
+\n\
+uint64_t *mt_attach(void);\n\
+\n\
+mt_counter mt_counter_new(const char *name, const char *help);\n\
+mt_gauge mt_gauge_new(const char *name, const char *help);\n\
+mt_histogram mt_histogram_new(const char *name, const char *help);\n\
+\n\
+/* Relaxed store of a plain sum: readers on other threads never see a\n\
+ * torn value, and no locked instruction is emitted.\n\
+ */\n\
+static inline void mt_slot_add(unsigned id, uint64_t n) {\n\
+    uint64_t *s = mt_slots;\n\
+    if (__builtin_expect(s == NULL, 0)) {\n\
+        s = mt_attach();\n\
+    }\n\
+    __atomic_store_n(&s[id], __atomic_load_n(&s[id], __ATOMIC_RELAXED) + n,\n\
+                     __ATOMIC_RELAXED);\n\
+}\n\
+\n\
+static inline void mt_add(mt_counter c, uint64_t n) {\n\
+    mt_slot_add(c.id, n);\n\
+}\n\
+\n\
+static inline void mt_inc(mt_counter c) {\n\
+    mt_slot_add(c.id, 1);\n\
+}\n\
+\n\
+/* Four linear sub-buckets per power of two: bucketing error <= 25% */\n\
+static inline unsigned mt_bucket(uint64_t v) {\n\
+    unsigned e;\n\
+    if (v < MT_SUB) {\n\
+        return (unsigned) v;\n\
+    }\n\
+    e = 63 - __builtin_clzll(v);\n\
+    if (e >= MT_MAX_EXP) {\n\
+        return MT_HBUCKETS - 1;\n\
+    }\n\
+    return MT_SUB * (e - MT_SUB_BITS + 1) +\n\
+           (unsigned) ((v >> (e - MT_SUB_BITS)) & (MT_SUB - 1));\n\
+}\n\
+\n\
+static inline void mt_observe(mt_histogram h, uint64_t v) {\n\
+    mt_slot_add(h.id + mt_bucket(v), 1);\n\
+    mt_slot_add(h.id + MT_HBUCKETS, v);\n\
+    mt_slot_add(h.id + MT_HBUCKETS + 1, 1);\n\
+}\n\
+\n\
+void mt_gauge_set(mt_gauge g, int64_t v);\n\
+void mt_gauge_add(mt_gauge g, int64_t v);\n\
+int64_t mt_gauge_read(mt_gauge g);\n\
+\n\
+uint64_t mt_counter_read(mt_counter c);\n\
+/* Upper bound of the bucket holding quantile q of the observations */\n\
+uint64_t mt_histogram_quantile(mt_histogram h, double q);\n\
+uint64_t mt_now_ns(void);\n\
+\n\
+/* Prometheus text exposition of every registered metric */\n\
+int metrics_write(FILE *out);\n\
+/* Writes to path.tmp and renames over path; 0 on success */\n\
+int metrics_dump(const char *path);\n\
+int metrics_dumper_start(const char *path, unsigned interval_s);\n\
+/* Stops the dumper after one last dump */\n\
+void metrics_dumper_stop(void);\n\
+\n\
+#endif\n";
+
+
+/* lib/Project_metrics.c */
+static const char METRICS_C[] = "\
+#include <errno.h>\n\
+#include <pthread.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <time.h>\n\
+#include <unistd.h>\n\
+\n\
+#include \"@PROJECT@_metrics.h\"\n\
+\n\
+/* Metrics registered once the tables are full land here: the last\n\
+ * slots of every shard and one gauge past the exposed ones, never\n\
+ * written out\n\
+ */\n\
+#define MT_SINK_SLOT (MT_MAX_SLOTS - (MT_HBUCKETS + 2))\n\
+#define MT_SINK_GAUGE MT_MAX_METRICS\n\
+\n\
+enum mt_type { MT_COUNTER, MT_GAUGE, MT_HISTOGRAM };\n\
+\n\
+struct mt_desc {\n\
+    const char *name;\n\
+    const char *help;\n\
+    enum mt_type type;\n\
+    unsigned id;\n\
+};\n\
+\n\
+/* Per-thread slot arrays, merged on read */\n\
+struct mt_shard {\n\
+    struct mt_shard *next;\n\
+    uint64_t slots[MT_MAX_SLOTS];\n\
+};\n\
+\n\
+__thread uint64_t *mt_slots;\n\
+\n\
+static pthread_mutex_t mt_lock = PTHREAD_MUTEX_INITIALIZER;\n\
+static pthread_once_t mt_once = PTHREAD_ONCE_INIT;\n\
+static pthread_key_t mt_key;\n\
+static struct mt_desc mt_descs[MT_MAX_METRICS];\n\
+static unsigned mt_ndescs;\n\
+static unsigned mt_nslots;\n\
+static unsigned mt_ngauges;\n\
+static int64_t mt_gauges[MT_MAX_METRICS + 1];\n\
+static uint64_t mt_retired[MT_MAX_SLOTS];   /* sums of exited threads */\n\
+static uint64_t mt_lost[MT_MAX_SLOTS];      /* threads without a shard */\n\
+static struct mt_shard *mt_shards;\n\
+\n\
+static void mt_detach(void *arg) {\n\
+    struct mt_shard *sh = arg, **pp;\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    for (unsigned i = 0; i < mt_nslots; i++) {\n\
+        mt_retired[i] += sh->slots[i];\n\
+    }\n\
+    for (pp = &mt_shards; *pp != NULL; pp = &(*pp)->next) {\n\
+        if (*pp == sh) {\n\
+            *pp = sh->next;\n\
+            break;\n\
+        }\n\
+    }\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    mt_slots = NULL;\n\
+    free(sh);\n\
+}\n\
+\n\
+static void mt_key_init(void) {\n\
+    pthread_key_create(&mt_key, mt_detach);\n\
+}\n\
+\n\
+/* First add on a thread: allocate and publish its shard */\n\
+uint64_t *mt_attach(void) {\n\
+    struct mt_shard *sh = calloc(1, sizeof(*sh));\n\
+    if (sh == NULL) {\n\
+        /* Shared by every such thread and never read: racy adds are fine */\n\
+        return mt_slots = mt_lost;\n\
+    }\n\
+    pthread_once(&mt_once, mt_key_init);\n\
+    pthread_setspecific(mt_key, sh);\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    sh->next = mt_shards;\n\
+    mt_shards = sh;\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    return mt_slots = sh->slots;\n\
+}\n\
+\n\
+static unsigned mt_register(const char *name, const char *help,\n\
+                            enum mt_type type, unsigned nslots) {\n\
+    unsigned id = 0;\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    if (mt_ndescs == MT_MAX_METRICS ||\n\
+            (type != MT_GAUGE && mt_nslots + nslots > MT_SINK_SLOT)) {\n\
+        /* Out of room: the metric still works but goes to the sink */\n\
+        fprintf(stderr, \"metrics: no room for %s\\n\", name);\n\
+        id = type == MT_GAUGE ? MT_SINK_GAUGE : MT_SINK_SLOT;\n\
+    } else {\n\
+        if (type == MT_GAUGE) {\n\
+            id = mt_ngauges++;\n\
+        } else {\n\
+            id = mt_nslots;\n\
+            mt_nslots += nslots;\n\
+        }\n\
+        mt_descs[mt_ndescs].name = name;\n\
+        mt_descs[mt_ndescs].help = help;\n\
+        mt_descs[mt_ndescs].type = type;\n\
+        mt_descs[mt_ndescs].id = id;\n\
+        mt_ndescs++;\n\
+    }\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    return id;\n\
+}\n\
+\n\
+mt_counter mt_counter_new(const char *name, const char *help) {\n\
+    mt_counter c = { mt_register(name, help, MT_COUNTER, 1) };\n\
+    return c;\n\
+}\n\
+\n\
+mt_gauge mt_gauge_new(const char *name, const char *help) {\n\
+    mt_gauge g = { mt_register(name, help, MT_GAUGE, 0) };\n\
+    return g;\n\
+}\n\
+\n\
+mt_histogram mt_histogram_new(const char *name, const char *help) {\n\
+    mt_histogram h = { mt_register(name, help, MT_HISTOGRAM, MT_HBUCKETS + 2) };\n\
+    return h;\n\
+}\n\
+\n\
+void mt_gauge_set(mt_gauge g, int64_t v) {\n\
+    __atomic_store_n(&mt_gauges[g.id], v, __ATOMIC_RELAXED);\n\
+}\n\
+\n\
+void mt_gauge_add(mt_gauge g, int64_t v) {\n\
+    __atomic_fetch_add(&mt_gauges[g.id], v, __ATOMIC_RELAXED);\n\
+}\n\
+\n\
+int64_t mt_gauge_read(mt_gauge g) {\n\
+    return __atomic_load_n(&mt_gauges[g.id], __ATOMIC_RELAXED);\n\
+}\n\
+\n\
+/* Sums slots [id, id + n) over every shard; mt_lock held */\n\
+static void mt_merge(unsigned id, unsigned n, uint64_t *out) {\n\
+    struct mt_shard *sh;\n\
+    memcpy(out, mt_retired + id, n * sizeof(*out));\n\
+    for (sh = mt_shards; sh != NULL; sh = sh->next) {\n\
+        for (unsigned i = 0; i < n; i++) {\n\
+            out[i] += __atomic_load_n(&sh->slots[id + i], __ATOMIC_RELAXED);\n\
+        }\n\
+    }\n\
+}\n\
+\n\
+uint64_t mt_counter_read(mt_counter c) {\n\
+    uint64_t v;\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    mt_merge(c.id, 1, &v);\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    return v;\n\
+}\n\
+\n\
+/* Exclusive upper bound of a histogram bucket */\n\
+static uint64_t mt_bucket_end(unsigned b) {\n\
+    unsigned e, sub;\n\
+    if (b < MT_SUB) {\n\
+        return b + 1;\n\
+    }\n\
+    e = b / MT_SUB + MT_SUB_BITS - 1;\n\
+    sub = b % MT_SUB;\n\
+    return (uint64_t) (MT_SUB + sub + 1) << (e - MT_SUB_BITS);\n\
+}\n\
+\n\
+uint64_t mt_histogram_quantile(mt_histogram h, double q) {\n\
+    uint64_t b[MT_HBUCKETS + 2], seen = 0;\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    mt_merge(h.id, MT_HBUCKETS + 2, b);\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    if (b[MT_HBUCKETS + 1] == 0) {\n\
+        return 0;\n\
+    }\n\
+    for (unsigned i = 0; i < MT_HBUCKETS; i++) {\n\
+        seen += b[i];\n\
+        if (seen >= q * b[MT_HBUCKETS + 1]) {\n\
+            return mt_bucket_end(i) - 1;\n\
+        }\n\
+    }\n\
+    return UINT64_MAX;\n\
+}\n\
+\n\
+uint64_t mt_now_ns(void) {\n\
+    struct timespec ts;\n\
+    clock_gettime(CLOCK_MONOTONIC, &ts);\n\
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;\n\
+}\n\
+\n\
+int metrics_write(FILE *out) {\n\
+    static const char *types[] = { \"counter\", \"gauge\", \"histogram\" };\n\
+    uint64_t b[MT_HBUCKETS + 2];\n\
+\n\
+    pthread_mutex_lock(&mt_lock);\n\
+    for (unsigned m = 0; m < mt_ndescs; m++) {\n\
+        const struct mt_desc *d = &mt_descs[m];\n\
+        fprintf(out, \"# HELP %s %s\\n# TYPE %s %s\\n\",\n\
+                d->name, d->help, d->name, types[d->type]);\n\
+        if (d->type == MT_GAUGE) {\n\
+            fprintf(out, \"%s %lld\\n\", d->name, (long long) mt_gauges[d->id]);\n\
+        } else if (d->type == MT_COUNTER) {\n\
+            mt_merge(d->id, 1, b);\n\
+            fprintf(out, \"%s %llu\\n\", d->name, (unsigned long long) b[0]);\n\
+        } else {\n\
+            /* Exposed at power-of-two boundaries; the sub-buckets only\n\
+             * serve in-process quantiles\n\
+             */\n\
+            uint64_t cum = 0;\n\
+            mt_merge(d->id, MT_HBUCKETS + 2, b);\n\
+            for (unsigned i = 0; i < MT_HBUCKETS - 1; i++) {\n\
+                cum += b[i];\n\
+                if (i < MT_SUB || i % MT_SUB == MT_SUB - 1) {\n\
+                    fprintf(out, \"%s_bucket{le=\\\"%llu\\\"} %llu\\n\", d->name,\n\
+                            (unsigned long long) mt_bucket_end(i) - 1,\n\
+                            (unsigned long long) cum);\n\
+                }\n\
+            }\n\
+            fprintf(out, \"%s_bucket{le=\\\"+Inf\\\"} %llu\\n%s_sum %llu\\n\"\n\
+                    \"%s_count %llu\\n\", d->name,\n\
+                    (unsigned long long) b[MT_HBUCKETS + 1], d->name,\n\
+                    (unsigned long long) b[MT_HBUCKETS], d->name,\n\
+                    (unsigned long long) b[MT_HBUCKETS + 1]);\n\
+        }\n\
+    }\n\
+    pthread_mutex_unlock(&mt_lock);\n\
+    return ferror(out) ? -1 : 0;\n\
+}\n\
+\n\
+int metrics_dump(const char *path) {\n\
+    char tmp[4096];\n\
+    FILE *out;\n\
+    int ret;\n\
+\n\
+    if (snprintf(tmp, sizeof(tmp), \"%s.tmp.%ld\", path, (long) getpid())\n\
+            >= (int) sizeof(tmp)) {\n\
+        return -1;\n\
+    }\n\
+    if ((out = fopen(tmp, \"w\")) == NULL) {\n\
+        return -1;\n\
+    }\n\
+    ret = metrics_write(out);\n\
+    if (fclose(out) != 0 || ret != 0 || rename(tmp, path) != 0) {\n\
+        unlink(tmp);\n\
+        return -1;\n\
+    }\n\
+    return 0;\n\
+}\n\
+\n\
+static struct {\n\
+    pthread_t tid;\n\
+    pthread_mutex_t lock;\n\
+    pthread_cond_t cv;\n\
+    char path[4096];\n\
+    unsigned interval;\n\
+    int running;\n\
+    int stop;\n\
+} mt_dumper = { .lock = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER };\n\
+\n\
+static void *mt_dumper_main(void *arg) {\n\
+    (void) arg;\n\
+    pthread_mutex_lock(&mt_dumper.lock);\n\
+    while (!mt_dumper.stop) {\n\
+        struct timespec until;\n\
+        clock_gettime(CLOCK_REALTIME, &until);\n\
+        until.tv_sec += mt_dumper.interval;\n\
+        while (!mt_dumper.stop &&\n\
+               pthread_cond_timedwait(&mt_dumper.cv, &mt_dumper.lock, &until)\n\
+                   != ETIMEDOUT) {\n\
+        }\n\
+        pthread_mutex_unlock(&mt_dumper.lock);\n\
+        if (metrics_dump(mt_dumper.path) != 0) {\n\
+            fprintf(stderr, \"metrics: cannot write %s\\n\", mt_dumper.path);\n\
+        }\n\
+        pthread_mutex_lock(&mt_dumper.lock);\n\
+    }\n\
+    pthread_mutex_unlock(&mt_dumper.lock);\n\
+    return NULL;\n\
+}\n\
+\n\
+int metrics_dumper_start(const char *path, unsigned interval_s) {\n\
+    int ret = -1;\n\
+    pthread_mutex_lock(&mt_dumper.lock);\n\
+    if (!mt_dumper.running && strlen(path) < sizeof(mt_dumper.path)) {\n\
+        strcpy(mt_dumper.path, path);\n\
+        mt_dumper.interval = interval_s > 0 ? interval_s : 1;\n\
+        mt_dumper.stop = 0;\n\
+        if (pthread_create(&mt_dumper.tid, NULL, mt_dumper_main, NULL) == 0) {\n\
+            mt_dumper.running = 1;\n\
+            ret = 0;\n\
+        }\n\
+    }\n\
+    pthread_mutex_unlock(&mt_dumper.lock);\n\
+    return ret;\n\
+}\n\
+\n\
+void metrics_dumper_stop(void) {\n\
+    pthread_mutex_lock(&mt_dumper.lock);\n\
+    if (!mt_dumper.running) {\n\
+        pthread_mutex_unlock(&mt_dumper.lock);\n\
+        return;\n\
+    }\n\
+    mt_dumper.stop = 1;\n\
+    pthread_cond_signal(&mt_dumper.cv);\n\
+    pthread_mutex_unlock(&mt_dumper.lock);\n\
+    pthread_join(mt_dumper.tid, NULL);\n\
+    mt_dumper.running = 0;\n\
+}\n";
+
+
+/* Appended to the generated Makefile */
+static const char METRICS_MAKE[] = "\
+\n\
+\n\
+# metrics component: lib/@PROJECT@_metrics.h, Prometheus text dumped\n\
+# to a file by metrics_dumper_start()\n\
+COMPONENT_SRC += lib/@PROJECT@_metrics.c\n\
+COMPONENT_CFLAGS += -pthread\n";
+
+
+#endif
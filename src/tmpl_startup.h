@@ -0,0 +1,358 @@
+/*
+ * Templates for the startup tool generated into every project: link
+ *      variants of the app (dynamic, release, static) and a spawner
+ *      that measures their exec-to-exit latency percentiles.
+ */
+
+#ifndef TMPL_STARTUP_H
+#define TMPL_STARTUP_H
+
+/* tools/Project_startup.c */
+static const char STARTUP_C[] = "\
+/*\n\
+ * startup: exec-to-exit latency of @PROJECT@ binaries\n\
+ *\n\
+ * Spawns each binary given on the command line RUNS times with\n\
+ * posix_spawn, stdio on /dev/null, and times from the spawn call to\n\
+ * waitpid returning. Runs are interleaved across binaries so drift in\n\
+ * machine state hits every variant alike. Prints percentiles per\n\
+ * binary and, with -o DIR, writes one JSON result per binary in the\n\
+ * bench/results format so projc bench-report can trend them. A binary\n\
+ * that exits non-zero is not timing what was asked for: its results\n\
+ * are not written and the run fails. A\n\
+ * binary has converged when the standard error of its mean is below\n\
+ * BENCH_TARGET (default 0.005) of the mean, as for bench_run.\n\
+ *\n\
+ *      @PROJECT@_startup [-n RUNS] [-w WARMUP] [-o DIR] [-p NAME]\n\
+ *              BINARY... [-- ARGS...]\n\
+ */\n\
+#define _GNU_SOURCE\n\
+#include <errno.h>\n\
+#include <fcntl.h>\n\
+#include <math.h>\n\
+#include <spawn.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <sys/stat.h>\n\
+#include <sys/wait.h>\n\
+#include <time.h>\n\
+#include <unistd.h>\n\
+\n\
+extern char **environ;\n\
+\n\
+struct target {\n\
+    const char *path;\n\
+    const char *variant;\n\
+    long long size;\n\
+    double *ns;\n\
+    size_t failures;\n\
+    int last_status;\n\
+};\n\
+\n\
+static double now_ns(void) {\n\
+    struct timespec ts;\n\
+    clock_gettime(CLOCK_MONOTONIC, &ts);\n\
+    return ts.tv_sec * 1e9 + ts.tv_nsec;\n\
+}\n\
+\n\
+/* One spawn and reap; returns elapsed ns or a negative value */\n\
+static double spawn_once(struct target *t, char **argv, posix_spawn_file_actions_t *fa) {\n\
+    pid_t pid;\n\
+    int status, err;\n\
+    double t0 = now_ns(), t1;\n\
+\n\
+    argv[0] = (char *) t->path;\n\
+    if ((err = posix_spawn(&pid, t->path, fa, NULL, argv, environ)) != 0) {\n\
+        fprintf(stderr, \"startup: %s: %s\\n\", t->path, strerror(err));\n\
+        return -1.0;\n\
+    }\n\
+    while (waitpid(pid, &status, 0) < 0) {\n\
+        if (errno != EINTR) {\n\
+            return -1.0;\n\
+        }\n\
+    }\n\
+    t1 = now_ns();\n\
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {\n\
+        t->failures++;\n\
+        t->last_status = status;\n\
+    }\n\
+    return t1 - t0;\n\
+}\n\
+\n\
+static int cmp_double(const void *a, const void *b) {\n\
+    double x = *(const double *) a, y = *(const double *) b;\n\
+    return (x > y) - (x < y);\n\
+}\n\
+\n\
+static double pct(const double *sorted, size_t n, double p) {\n\
+    size_t i = (size_t) (p * (n - 1) + 0.5);\n\
+    return sorted[i < n ? i : n - 1];\n\
+}\n\
+\n\
+static void fmt_ns(char *dest, size_t cap, double ns) {\n\
+    if (ns >= 1e6) {\n\
+        snprintf(dest, cap, \"%.2fms\", ns / 1e6);\n\
+    } else {\n\
+        snprintf(dest, cap, \"%.1fus\", ns / 1e3);\n\
+    }\n\
+}\n\
+\n\
+static void fmt_size(char *dest, size_t cap, long long bytes) {\n\
+    if (bytes >= 1 << 20) {\n\
+        snprintf(dest, cap, \"%.1fM\", bytes / 1048576.0);\n\
+    } else {\n\
+        snprintf(dest, cap, \"%.1fK\", bytes / 1024.0);\n\
+    }\n\
+}\n\
+\n\
+static void json_str(FILE *fp, const char *s) {\n\
+    fputc('\"', fp);\n\
+    for (; *s != '\\0'; s++) {\n\
+        if (*s == '\"' || *s == '\\\\') {\n\
+            fputc('\\\\', fp);\n\
+        }\n\
+        fputc((unsigned char) *s < 0x20 ? '?' : *s, fp);\n\
+    }\n\
+    fputc('\"', fp);\n\
+}\n\
+\n\
+static int write_json(const char *dir, const char *project, const struct target *t,\n\
+                      size_t n, double mean, double stddev, double target) {\n\
+    char path[4096], tmp[4120], host[64] = \"unknown\";\n\
+    time_t ts = time(NULL);\n\
+    double rel_err = mean > 0.0 ? stddev / sqrt((double) n) / mean : 0.0;\n\
+    FILE *fp;\n\
+    int ret = 0;\n\
+\n\
+    gethostname(host, sizeof(host) - 1);\n\
+    snprintf(tmp, sizeof(tmp), \"%s/startup_%s-%lld.%ld.tmp\", dir, t->variant,\n\
+             (long long) ts, (long) getpid());\n\
+    mkdir(dir, 0755);\n\
+    if ((fp = fopen(tmp, \"w\")) == NULL) {\n\
+        return 0;\n\
+    }\n\
+    fprintf(fp, \"{\\n  \\\"project\\\": \");\n\
+    json_str(fp, project);\n\
+    fprintf(fp, \",\\n  \\\"benchmark\\\": \\\"startup_%s\\\",\\n  \\\"timestamp\\\": %lld,\\n  \\\"host\\\": \",\n\
+            t->variant, (long long) ts);\n\
+    json_str(fp, host);\n\
+    fprintf(fp, \",\\n  \\\"unit\\\": \\\"ns/op\\\",\\n  \\\"median\\\": %.1f,\\n  \\\"mean\\\": %.1f,\\n\"\n\
+            \"  \\\"min\\\": %.1f,\\n  \\\"p90\\\": %.1f,\\n  \\\"p99\\\": %.1f,\\n  \\\"p999\\\": %.1f,\\n\"\n\
+            \"  \\\"max\\\": %.1f,\\n  \\\"stddev\\\": %.1f,\\n  \\\"rel_err\\\": %.6f,\\n\"\n\
+            \"  \\\"samples\\\": %zu,\\n  \\\"iters_per_sample\\\": 1,\\n  \\\"converged\\\": %s,\\n\"\n\
+            \"  \\\"binary\\\": \",\n\
+            pct(t->ns, n, 0.5), mean, t->ns[0], pct(t->ns, n, 0.9), pct(t->ns, n, 0.99),\n\
+            pct(t->ns, n, 0.999), t->ns[n - 1], stddev, rel_err, n,\n\
+            rel_err < target ? \"true\" : \"false\");\n\
+    json_str(fp, t->path);\n\
+    fprintf(fp, \",\\n  \\\"size_bytes\\\": %lld,\\n  \\\"failures\\\": %zu,\\n  \\\"warnings\\\": []\\n}\\n\",\n\
+            t->size, t->failures);\n\
+    /* As in the bench runner: link() never replaces an earlier run's\n\
+     * file from the same second, the next suffix is tried instead\n\
+     */\n\
+    if (fclose(fp) == 0) {\n\
+        for (int i = 0; i < 1000 && !ret; i++) {\n\
+            snprintf(path, sizeof(path), i ? \"%s/startup_%s-%lld-%d.json\"\n\
+                     : \"%s/startup_%s-%lld.json\", dir, t->variant, (long long) ts, i);\n\
+            if (link(tmp, path) == 0) {\n\
+                ret = 1;\n\
+            } else if (errno != EEXIST) {\n\
+                ret = rename(tmp, path) == 0;\n\
+                break;\n\
+            }\n\
+        }\n\
+    }\n\
+    unlink(tmp);\n\
+    return ret;\n\
+}\n\
+\n\
+int main(int argc, char *argv[]) {\n\
+    size_t runs = 2000, warmup = 50, ntargets = 0;\n\
+    const char *outdir = NULL, *project = \"@PROJECT@\";\n\
+    const char *target_env = getenv(\"BENCH_TARGET\");\n\
+    double target = target_env != NULL ? atof(target_env) : 0.005;\n\
+    struct target *targets = calloc(argc, sizeof(*targets));\n\
+    char **child_argv = calloc(argc + 1, sizeof(char *));\n\
+    posix_spawn_file_actions_t fa;\n\
+    int opt, nargs = 1, failed = 0;\n\
+\n\
+    while ((opt = getopt(argc, argv, \"+n:w:o:p:h\")) != -1) {\n\
+        switch (opt) {\n\
+            case 'n':\n\
+                runs = strtoul(optarg, NULL, 10);\n\
+                break;\n\
+            case 'w':\n\
+                warmup = strtoul(optarg, NULL, 10);\n\
+                break;\n\
+            case 'o':\n\
+                outdir = optarg;\n\
+                break;\n\
+            case 'p':\n\
+                project = optarg;\n\
+                break;\n\
+            default:\n\
+                fprintf(stderr, \"usage: %s [-n RUNS] [-w WARMUP] [-o DIR] [-p NAME]\"\n\
+                        \" BINARY... [-- ARGS...]\\n\", argv[0]);\n\
+                return opt != 'h';\n\
+        }\n\
+    }\n\
+    for (int i = optind; i < argc; i++) {\n\
+        struct stat st;\n\
+        struct target *t = &targets[ntargets];\n\
+        const char *base, *dot;\n\
+        if (strcmp(argv[i], \"--\") == 0) {\n\
+            for (i++; i < argc; i++) {\n\
+                child_argv[nargs++] = argv[i];\n\
+            }\n\
+            break;\n\
+        }\n\
+        if (stat(argv[i], &st) != 0 || access(argv[i], X_OK) != 0) {\n\
+            fprintf(stderr, \"startup: %s is not an executable\\n\", argv[i]);\n\
+            return 1;\n\
+        }\n\
+        t->path = argv[i];\n\
+        t->size = (long long) st.st_size;\n\
+        base = strrchr(argv[i], '/');\n\
+        base = base ? base + 1 : argv[i];\n\
+        dot = strrchr(base, '.');\n\
+        t->variant = dot ? dot + 1 : base;\n\
+        ntargets++;\n\
+    }\n\
+    if (ntargets == 0 || runs == 0) {\n\
+        fprintf(stderr, \"startup: no binaries given\\n\");\n\
+        return 1;\n\
+    }\n\
+    for (size_t i = 0; i < ntargets; i++) {\n\
+        if ((targets[i].ns = malloc(runs * sizeof(double))) == NULL) {\n\
+            return 1;\n\
+        }\n\
+    }\n\
+\n\
+    posix_spawn_file_actions_init(&fa);\n\
+    posix_spawn_file_actions_addopen(&fa, 0, \"/dev/null\", O_RDONLY, 0);\n\
+    posix_spawn_file_actions_addopen(&fa, 1, \"/dev/null\", O_WRONLY, 0);\n\
+    posix_spawn_file_actions_addopen(&fa, 2, \"/dev/null\", O_WRONLY, 0);\n\
+\n\
+    /* Warm the page cache and the dynamic loader's files first */\n\
+    for (size_t r = 0; r < warmup; r++) {\n\
+        for (size_t i = 0; i < ntargets; i++) {\n\
+            if (spawn_once(&targets[i], child_argv, &fa) < 0) {\n\
+                return 1;\n\
+            }\n\
+        }\n\
+    }\n\
+    for (size_t i = 0; i < ntargets; i++) {\n\
+        targets[i].failures = 0;\n\
+    }\n\
+    for (size_t r = 0; r < runs; r++) {\n\
+        for (size_t i = 0; i < ntargets; i++) {\n\
+            if ((targets[i].ns[r] = spawn_once(&targets[i], child_argv, &fa)) < 0) {\n\
+                return 1;\n\
+            }\n\
+        }\n\
+    }\n\
+    posix_spawn_file_actions_destroy(&fa);\n\
+\n\
+    printf(\"%-36s %8s %10s %10s %10s %10s %10s %7s\\n\", \"binary\", \"size\", \"min\", \"p50\",\n\
+           \"p90\", \"p99\", \"p99.9\", \"vs 1st\");\n\
+    for (size_t i = 0; i < ntargets; i++) {\n\
+        struct target *t = &targets[i];\n\
+        double mean = 0.0, var = 0.0, rel_err;\n\
+        char sz[16], a[16], b[16], c[16], d[16], e[16];\n\
+\n\
+        qsort(t->ns, runs, sizeof(double), cmp_double);\n\
+        for (size_t r = 0; r < runs; r++) {\n\
+            mean += t->ns[r];\n\
+        }\n\
+        mean /= runs;\n\
+        for (size_t r = 0; r < runs; r++) {\n\
+            var += (t->ns[r] - mean) * (t->ns[r] - mean);\n\
+        }\n\
+        var = runs > 1 ? var / (runs - 1) : 0.0;\n\
+        fmt_size(sz, sizeof(sz), t->size);\n\
+        fmt_ns(a, sizeof(a), t->ns[0]);\n\
+        fmt_ns(b, sizeof(b), pct(t->ns, runs, 0.5));\n\
+        fmt_ns(c, sizeof(c), pct(t->ns, runs, 0.9));\n\
+        fmt_ns(d, sizeof(d), pct(t->ns, runs, 0.99));\n\
+        fmt_ns(e, sizeof(e), pct(t->ns, runs, 0.999));\n\
+        printf(\"%-36s %8s %10s %10s %10s %10s %10s %6.2fx\\n\", t->path, sz, a, b, c, d, e,\n\
+               pct(targets[0].ns, runs, 0.5) / pct(t->ns, runs, 0.5));\n\
+        if (t->failures > 0) {\n\
+            printf(\"    %zu of %zu runs failed (last status 0x%x); not recorded\\n\",\n\
+                   t->failures, runs, t->last_status);\n\
+            failed = 1;\n\
+            continue;\n\
+        }\n\
+        rel_err = mean > 0.0 ? sqrt(var) / sqrt((double) runs) / mean : 0.0;\n\
+        if (rel_err >= target) {\n\
+            printf(\"    not converged: mean +- %.2f%%, above the %.2f%% target\\n\",\n\
+                   100.0 * rel_err, 100.0 * target);\n\
+        }\n\
+        if (outdir != NULL && !write_json(outdir, project, t, runs, mean, sqrt(var), target)) {\n\
+            fprintf(stderr, \"startup: cannot write results to %s\\n\", outdir);\n\
+        }\n\
+    }\n\
+    printf(\"%zu runs each after %zu warmup runs, interleaved; vs 1st compares p50\\n\",\n\
+           runs, warmup);\n\
+    if (failed) {\n\
+        fprintf(stderr, \"startup: some binaries exited non-zero; check the arguments after --\\n\");\n\
+    }\n\
+    return failed;\n\
+}\n";
+
+
+
+/* Appended to the generated Makefile */
+static const char STARTUP_MAKE[] = "\
+\n\
+\n\
+# make static / make release: link variants of @PROJECT@_app for\n\
+# short-lived tools, where loading and relocation dominate the run.\n\
+# make startup-bench spawns every variant STARTUP_RUNS times and\n\
+# prints exec-to-exit latency percentiles (STARTUP_ARGS go to the app)\n\
+STARTUP_RUNS=2000\n\
+STARTUP_ARGS=\n\
+LINK_SRC=src/@PROJECT@_app.c lib/@PROJECT@.c\n\
+LINK_CFLAGS=-O2 -Wall -pthread -Ilib -I$(IDIR)\n\
+RELEASE_LDFLAGS=-Wl,-z,now -Wl,-O1 -Wl,--hash-style=gnu\n\
+LINK_VARIANTS=build/link/@PROJECT@_app.dynamic build/link/@PROJECT@_app.release \\\n\
+	build/link/@PROJECT@_app.static\n\
+\n\
+build/link/@PROJECT@_app.dynamic: $(LINK_SRC)\n\
+	@mkdir -p build/link\n\
+	$(CC) -o $@ $(LINK_SRC) $(COMPONENT_SRC) $(LINK_CFLAGS) $(COMPONENT_CFLAGS) $(LIBS)\n\
+\n\
+build/link/@PROJECT@_app.release: $(LINK_SRC)\n\
+	@mkdir -p build/link\n\
+	$(CC) -o $@ $(LINK_SRC) $(COMPONENT_SRC) $(LINK_CFLAGS) $(COMPONENT_CFLAGS) \\\n\
+		$(RELEASE_LDFLAGS) $(LIBS)\n\
+\n\
+# -static-pie keeps ASLR; toolchains without it get a plain -static.\n\
+# Probed once, by linking an empty program, when the rule first runs\n\
+STATIC_LDFLAGS=$(eval STATIC_LDFLAGS:=$(shell echo 'int main(void) { return 0; }' | \\\n\
+	$(CC) -static-pie -fPIE -x c -o /dev/null - 2>/dev/null && \\\n\
+	echo -static-pie -fPIE || echo -static))$(STATIC_LDFLAGS)\n\
+\n\
+build/link/@PROJECT@_app.static: $(LINK_SRC)\n\
+	@mkdir -p build/link\n\
+	$(CC) $(STATIC_LDFLAGS) -o $@ $(LINK_SRC) $(COMPONENT_SRC) $(LINK_CFLAGS) \\\n\
+		$(COMPONENT_CFLAGS) $(RELEASE_LDFLAGS) $(LIBS)\n\
+\n\
+build/@PROJECT@_startup: tools/@PROJECT@_startup.c\n\
+	@mkdir -p build\n\
+	$(CC) -O2 -Wall -o $@ $< -lm\n\
+\n\
+.PHONY: static release startup-bench\n\
+\n\
+static: build/link/@PROJECT@_app.static\n\
+\n\
+release: build/link/@PROJECT@_app.release\n\
+\n\
+startup-bench: build/@PROJECT@_startup $(LINK_VARIANTS)\n\
+	./build/@PROJECT@_startup -n $(STARTUP_RUNS) -p @PROJECT@ -o bench/results \\\n\
+		$(LINK_VARIANTS) -- $(STARTUP_ARGS)\n";
+
+
+
+#endif
@@ -0,0 +1,1145 @@
+/*
+ * Templates for the uring-batch archetype: a file-processing engine
+ *      that keeps a fixed queue depth of reads in flight through
+ *      io_uring with registered buffers, processes completions on
+ *      worker threads and writes result lines with linked SQEs.
+ *      Falls back to a pread() loop when io_uring is unavailable.
+ *
+ * @PROJECT@ is replaced with the project name, @GUARD@ with its
+ *      upper-cased identifier form.
+ */
+
+#ifndef TMPL_URING_H
+#define TMPL_URING_H
+
+/* lib/Project.h */
+static const char URING_LIB_H[] = "\
+#ifndef @GUARD@_H\n\
+#define @GUARD@_H\n\
+\n\
+#include <stdatomic.h>\n\
+#include <stddef.h>\n\
+\n\
+/* Batch file processing engine: keeps a fixed number of reads in\n\
+ * flight through io_uring and hands completed chunks to worker\n\
+ * threads. Falls back to a pread() loop when io_uring is unavailable.\n\
+ */\n\
+\n\
+struct batch_opts {\n\
+    unsigned depth;     /* reads kept in flight */\n\
+    unsigned threads;   /* worker threads processing completions */\n\
+    size_t buf_size;    /* size of each registered read buffer */\n\
+    int out_fd;         /* results are written here */\n\
+    int force_pread;    /* skip io_uring even when it is available */\n\
+    /* Optional: runs first on worker thread i, e.g. to pin it */\n\
+    void (*thread_start)(void *arg, unsigned i);\n\
+    void *thread_arg;\n\
+};\n\
+\n\
+struct batch_stats {\n\
+    size_t files;\n\
+    size_t failed;\n\
+    size_t bytes;\n\
+    int used_uring;\n\
+    int used_fixed_bufs;\n\
+};\n\
+\n\
+/* Per-file accumulator; chunks of one file may be processed\n\
+ * concurrently and out of order, so updates must be atomic.\n\
+ */\n\
+struct batch_result {\n\
+    atomic_size_t bytes;\n\
+    atomic_size_t lines;\n\
+};\n\
+\n\
+/* Per-chunk processing hook, replace with the real work */\n\
+void batch_process_chunk(struct batch_result *r, size_t off,\n\
+                         const char *data, size_t len);\n\
+\n\
+/* Formats the result line written for one file */\n\
+int batch_format_result(char *dst, size_t cap, const char *path,\n\
+                        struct batch_result *r);\n\
+\n\
+/* 0 on success, -1 if any file failed */\n\
+int batch_run(char *const *paths, size_t n, const struct batch_opts *o,\n\
+              struct batch_stats *st);\n\
+\n\
+#endif\n";
+
+
+/* lib/Project.c */
+static const char URING_LIB_C[] = "\
+#define _GNU_SOURCE\n\
+#include <errno.h>\n\
+#include <fcntl.h>\n\
+#include <pthread.h>\n\
+#include <stdint.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <sys/stat.h>\n\
+#include <sys/uio.h>\n\
+#include <unistd.h>\n\
+\n\
+#include \"@PROJECT@.h\"\n\
+\n\
+#if defined(__linux__) && defined(__has_include)\n\
+#if __has_include(<linux/io_uring.h>)\n\
+#define BATCH_HAVE_URING 1\n\
+#include <linux/io_uring.h>\n\
+#include <sys/mman.h>\n\
+#include <sys/syscall.h>\n\
+#endif\n\
+#endif\n\
+\n\
+#define BATCH_LINE_MAX 4352\n\
+#define BATCH_SLABS 4\n\
+#define BATCH_SLAB_SIZE (64 * 1024)\n\
+\n\
+void batch_process_chunk(struct batch_result *r, size_t off,\n\
+                         const char *data, size_t len) {\n\
+    const char *p = data, *end = data + len;\n\
+    size_t lines = 0;\n\
+    (void) off;\n\
+    while ((p = memchr(p, '\\n', end - p)) != NULL) {\n\
+        lines++;\n\
+        p++;\n\
+    }\n\
+    atomic_fetch_add_explicit(&r->lines, lines, memory_order_relaxed);\n\
+    atomic_fetch_add_explicit(&r->bytes, len, memory_order_relaxed);\n\
+}\n\
+\n\
+int batch_format_result(char *dst, size_t cap, const char *path,\n\
+                        struct batch_result *r) {\n\
+    return snprintf(dst, cap, \"%zu %zu %s\\n\",\n\
+                    atomic_load(&r->lines), atomic_load(&r->bytes), path);\n\
+}\n\
+\n\
+static int write_all(int fd, const char *buf, size_t len, off_t off) {\n\
+    while (len > 0) {\n\
+        ssize_t w = off < 0 ? write(fd, buf, len) : pwrite(fd, buf, len, off);\n\
+        if (w < 0) {\n\
+            if (errno == EINTR) {\n\
+                continue;\n\
+            }\n\
+            return -1;\n\
+        }\n\
+        buf += w;\n\
+        len -= w;\n\
+        if (off >= 0) {\n\
+            off += w;\n\
+        }\n\
+    }\n\
+    return 0;\n\
+}\n\
+\n\
+/* Hands each worker thread its index for o->thread_start */\n\
+static void thread_started(const struct batch_opts *o, atomic_uint *started) {\n\
+    if (o->thread_start != NULL) {\n\
+        o->thread_start(o->thread_arg, atomic_fetch_add(started, 1));\n\
+    }\n\
+}\n\
+\n\
+static void stats_fill(struct batch_stats *st, size_t files, size_t failed,\n\
+                       size_t bytes) {\n\
+    if (st != NULL) {\n\
+        st->files = files;\n\
+        st->failed = failed;\n\
+        st->bytes = bytes;\n\
+    }\n\
+}\n\
+\n\
+\n\
+/* pread fallback: every worker takes the next file and reads it whole */\n\
+\n\
+struct pread_ctx {\n\
+    char *const *paths;\n\
+    size_t n;\n\
+    const struct batch_opts *o;\n\
+    atomic_size_t next;\n\
+    atomic_size_t failed;\n\
+    atomic_size_t bytes;\n\
+    atomic_uint workers;\n\
+    pthread_mutex_t out_lock;\n\
+};\n\
+\n\
+static void *pread_worker(void *arg) {\n\
+    struct pread_ctx *c = arg;\n\
+    char *buf = malloc(c->o->buf_size);\n\
+    char line[BATCH_LINE_MAX];\n\
+    size_t i;\n\
+\n\
+    thread_started(c->o, &c->workers);\n\
+    if (buf == NULL) {\n\
+        return NULL;\n\
+    }\n\
+    while ((i = atomic_fetch_add(&c->next, 1)) < c->n) {\n\
+        struct batch_result r = {0};\n\
+        off_t off = 0;\n\
+        ssize_t got = 0;\n\
+        int fd = open(c->paths[i], O_RDONLY | O_CLOEXEC);\n\
+        if (fd < 0) {\n\
+            fprintf(stderr, \"%s: %s\\n\", c->paths[i], strerror(errno));\n\
+            atomic_fetch_add(&c->failed, 1);\n\
+            continue;\n\
+        }\n\
+        while ((got = pread(fd, buf, c->o->buf_size, off)) > 0) {\n\
+            batch_process_chunk(&r, off, buf, got);\n\
+            off += got;\n\
+        }\n\
+        close(fd);\n\
+        if (got < 0) {\n\
+            fprintf(stderr, \"%s: %s\\n\", c->paths[i], strerror(errno));\n\
+            atomic_fetch_add(&c->failed, 1);\n\
+            continue;\n\
+        }\n\
+        atomic_fetch_add(&c->bytes, (size_t) off);\n\
+        int len = batch_format_result(line, sizeof(line), c->paths[i], &r);\n\
+        if (len > 0) {\n\
+            pthread_mutex_lock(&c->out_lock);\n\
+            write_all(c->o->out_fd, line, (size_t) len < sizeof(line)\n\
+                      ? (size_t) len : sizeof(line) - 1, -1);\n\
+            pthread_mutex_unlock(&c->out_lock);\n\
+        }\n\
+    }\n\
+    free(buf);\n\
+    return NULL;\n\
+}\n\
+\n\
+static int pread_run(char *const *paths, size_t n, const struct batch_opts *o,\n\
+                     struct batch_stats *st) {\n\
+    struct pread_ctx c = { .paths = paths, .n = n, .o = o };\n\
+    pthread_t *tids = calloc(o->threads, sizeof(*tids));\n\
+    unsigned started = 0;\n\
+\n\
+    if (tids == NULL) {\n\
+        return -1;\n\
+    }\n\
+    pthread_mutex_init(&c.out_lock, NULL);\n\
+    for (unsigned i = 0; i < o->threads; i++) {\n\
+        if (pthread_create(&tids[i], NULL, pread_worker, &c) == 0) {\n\
+            started++;\n\
+        }\n\
+    }\n\
+    if (started == 0) {\n\
+        pread_worker(&c);\n\
+    }\n\
+    for (unsigned i = 0; i < started; i++) {\n\
+        pthread_join(tids[i], NULL);\n\
+    }\n\
+    pthread_mutex_destroy(&c.out_lock);\n\
+    free(tids);\n\
+    stats_fill(st, n, atomic_load(&c.failed), atomic_load(&c.bytes));\n\
+    return atomic_load(&c.failed) ? -1 : 0;\n\
+}\n\
+\n\
+\n\
+#ifdef BATCH_HAVE_URING\n\
+\n\
+/* Minimal io_uring wrapper over the raw syscalls, so the template\n\
+ * has no liburing dependency.\n\
+ */\n\
+struct ring {\n\
+    int fd;\n\
+    unsigned sq_entries;\n\
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;\n\
+    unsigned *cq_head, *cq_tail, *cq_mask;\n\
+    struct io_uring_sqe *sqes;\n\
+    struct io_uring_cqe *cqes;\n\
+    void *sq_ptr, *cq_ptr;\n\
+    size_t sq_sz, cq_sz, sqes_sz;\n\
+    unsigned local_tail;\n\
+};\n\
+\n\
+static int ring_init(struct ring *r, unsigned entries) {\n\
+    struct io_uring_params p;\n\
+    memset(&p, 0, sizeof(p));\n\
+    memset(r, 0, sizeof(*r));\n\
+\n\
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);\n\
+    if (r->fd < 0) {\n\
+        return -errno;\n\
+    }\n\
+    /* IORING_OP_READ/WRITE and offset -1 writes arrived together with\n\
+     * this flag (5.6); without them every plain read would fail, so\n\
+     * report the ring as unavailable and let pread take over.\n\
+     */\n\
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {\n\
+        close(r->fd);\n\
+        return -EOPNOTSUPP;\n\
+    }\n\
+    r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);\n\
+    r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);\n\
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {\n\
+        r->sq_sz = r->cq_sz = r->sq_sz > r->cq_sz ? r->sq_sz : r->cq_sz;\n\
+    }\n\
+    r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE,\n\
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);\n\
+    if (r->sq_ptr == MAP_FAILED) {\n\
+        goto fail;\n\
+    }\n\
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {\n\
+        r->cq_ptr = r->sq_ptr;\n\
+    } else {\n\
+        r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE,\n\
+                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);\n\
+        if (r->cq_ptr == MAP_FAILED) {\n\
+            goto fail;\n\
+        }\n\
+    }\n\
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);\n\
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,\n\
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);\n\
+    if (r->sqes == MAP_FAILED) {\n\
+        goto fail;\n\
+    }\n\
+    r->sq_entries = p.sq_entries;\n\
+    r->sq_head = (unsigned *) ((char *) r->sq_ptr + p.sq_off.head);\n\
+    r->sq_tail = (unsigned *) ((char *) r->sq_ptr + p.sq_off.tail);\n\
+    r->sq_mask = (unsigned *) ((char *) r->sq_ptr + p.sq_off.ring_mask);\n\
+    r->sq_array = (unsigned *) ((char *) r->sq_ptr + p.sq_off.array);\n\
+    r->cq_head = (unsigned *) ((char *) r->cq_ptr + p.cq_off.head);\n\
+    r->cq_tail = (unsigned *) ((char *) r->cq_ptr + p.cq_off.tail);\n\
+    r->cq_mask = (unsigned *) ((char *) r->cq_ptr + p.cq_off.ring_mask);\n\
+    r->cqes = (struct io_uring_cqe *) ((char *) r->cq_ptr + p.cq_off.cqes);\n\
+    r->local_tail = *r->sq_tail;\n\
+    return 0;\n\
+\n\
+fail:\n\
+    if (r->sqes != NULL && r->sqes != MAP_FAILED) {\n\
+        munmap(r->sqes, r->sqes_sz);\n\
+    }\n\
+    if (r->cq_ptr != NULL && r->cq_ptr != MAP_FAILED && r->cq_ptr != r->sq_ptr) {\n\
+        munmap(r->cq_ptr, r->cq_sz);\n\
+    }\n\
+    if (r->sq_ptr != MAP_FAILED) {\n\
+        munmap(r->sq_ptr, r->sq_sz);\n\
+    }\n\
+    close(r->fd);\n\
+    return -ENOMEM;\n\
+}\n\
+\n\
+static void ring_exit(struct ring *r) {\n\
+    munmap(r->sqes, r->sqes_sz);\n\
+    if (r->cq_ptr != r->sq_ptr) {\n\
+        munmap(r->cq_ptr, r->cq_sz);\n\
+    }\n\
+    munmap(r->sq_ptr, r->sq_sz);\n\
+    close(r->fd);\n\
+}\n\
+\n\
+static struct io_uring_sqe *ring_get_sqe(struct ring *r) {\n\
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);\n\
+    unsigned idx;\n\
+    if (r->local_tail - head >= r->sq_entries) {\n\
+        return NULL;\n\
+    }\n\
+    idx = r->local_tail & *r->sq_mask;\n\
+    r->sq_array[idx] = idx;\n\
+    r->local_tail++;\n\
+    memset(&r->sqes[idx], 0, sizeof(r->sqes[idx]));\n\
+    return &r->sqes[idx];\n\
+}\n\
+\n\
+static int ring_submit(struct ring *r, unsigned wait_nr) {\n\
+    unsigned n = r->local_tail - *r->sq_tail;\n\
+    int ret;\n\
+    __atomic_store_n(r->sq_tail, r->local_tail, __ATOMIC_RELEASE);\n\
+    do {\n\
+        ret = syscall(__NR_io_uring_enter, r->fd, n, wait_nr,\n\
+                      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);\n\
+    } while (ret < 0 && errno == EINTR);\n\
+    return ret < 0 ? -errno : ret;\n\
+}\n\
+\n\
+enum { TAG_READ = 0, TAG_WRITE = 1 };\n\
+\n\
+struct bfile {\n\
+    const char *path;\n\
+    int fd;\n\
+    off_t size;\n\
+    off_t next;\n\
+    atomic_uint refs;   /* outstanding chunks plus the issuer's reference */\n\
+    atomic_int failed;\n\
+    struct batch_result res;\n\
+};\n\
+\n\
+struct job {\n\
+    struct bfile *f;\n\
+    unsigned idx;\n\
+    off_t off;\n\
+    size_t len;\n\
+    int res;\n\
+};\n\
+\n\
+struct line {\n\
+    struct line *next;\n\
+    size_t len;\n\
+    char s[];\n\
+};\n\
+\n\
+struct slab {\n\
+    size_t len;\n\
+    char data[BATCH_SLAB_SIZE];\n\
+};\n\
+\n\
+struct uring_ctx {\n\
+    const struct batch_opts *o;\n\
+    size_t n;\n\
+    char *bufs;\n\
+\n\
+    pthread_mutex_t lock;\n\
+    pthread_cond_t work_cv;\n\
+    pthread_cond_t main_cv;\n\
+    struct job *meta;       /* per buffer: the read it is serving */\n\
+    struct job *jobs;       /* ring of completed reads, depth entries */\n\
+    unsigned jhead, jcount;\n\
+    unsigned *free_bufs;    /* stack of idle buffer indices */\n\
+    unsigned free_top;\n\
+    struct line *res_head, *res_tail;\n\
+    size_t completed;\n\
+    size_t failed;\n\
+    size_t bytes;           /* read and processed, counted on completion */\n\
+    atomic_uint workers;\n\
+    int stop;\n\
+};\n\
+\n\
+static void file_done(struct uring_ctx *c, struct bfile *f) {\n\
+    char tmp[BATCH_LINE_MAX];\n\
+    struct line *l = NULL;\n\
+    int len = 0;\n\
+\n\
+    if (f->fd >= 0) {\n\
+        close(f->fd);\n\
+        f->fd = -1;\n\
+    }\n\
+    if (!atomic_load(&f->failed)) {\n\
+        len = batch_format_result(tmp, sizeof(tmp), f->path, &f->res);\n\
+        if (len >= (int) sizeof(tmp)) {\n\
+            len = sizeof(tmp) - 1;\n\
+        }\n\
+    }\n\
+    if (len > 0 && (l = malloc(sizeof(*l) + len)) != NULL) {\n\
+        l->next = NULL;\n\
+        l->len = len;\n\
+        memcpy(l->s, tmp, len);\n\
+    }\n\
+    pthread_mutex_lock(&c->lock);\n\
+    if (l != NULL) {\n\
+        if (c->res_tail != NULL) {\n\
+            c->res_tail->next = l;\n\
+        } else {\n\
+            c->res_head = l;\n\
+        }\n\
+        c->res_tail = l;\n\
+    }\n\
+    if (atomic_load(&f->failed)) {\n\
+        c->failed++;\n\
+    }\n\
+    c->completed++;\n\
+    pthread_cond_signal(&c->main_cv);\n\
+    pthread_mutex_unlock(&c->lock);\n\
+}\n\
+\n\
+static void file_put(struct uring_ctx *c, struct bfile *f) {\n\
+    if (atomic_fetch_sub(&f->refs, 1) == 1) {\n\
+        file_done(c, f);\n\
+    }\n\
+}\n\
+\n\
+static void *uring_worker(void *arg) {\n\
+    struct uring_ctx *c = arg;\n\
+    thread_started(c->o, &c->workers);\n\
+    for (;;) {\n\
+        struct job j;\n\
+        pthread_mutex_lock(&c->lock);\n\
+        while (c->jcount == 0 && !c->stop) {\n\
+            pthread_cond_wait(&c->work_cv, &c->lock);\n\
+        }\n\
+        if (c->jcount == 0) {\n\
+            pthread_mutex_unlock(&c->lock);\n\
+            break;\n\
+        }\n\
+        j = c->jobs[c->jhead];\n\
+        c->jhead = (c->jhead + 1) % c->o->depth;\n\
+        c->jcount--;\n\
+        pthread_mutex_unlock(&c->lock);\n\
+\n\
+        char *buf = c->bufs + (size_t) j.idx * c->o->buf_size;\n\
+        ssize_t got = j.res;\n\
+        /* Short reads are rare on regular files; finish them inline */\n\
+        while (got >= 0 && (size_t) got < j.len) {\n\
+            ssize_t more = pread(j.f->fd, buf + got, j.len - got, j.off + got);\n\
+            if (more <= 0) {\n\
+                got = more < 0 ? -errno : got;\n\
+                break;\n\
+            }\n\
+            got += more;\n\
+        }\n\
+        if (got < 0) {\n\
+            fprintf(stderr, \"%s: %s\\n\", j.f->path, strerror((int) -got));\n\
+            atomic_store(&j.f->failed, 1);\n\
+        } else {\n\
+            batch_process_chunk(&j.f->res, j.off, buf, got);\n\
+        }\n\
+\n\
+        pthread_mutex_lock(&c->lock);\n\
+        if (got > 0) {\n\
+            c->bytes += (size_t) got;\n\
+        }\n\
+        c->free_bufs[c->free_top++] = j.idx;\n\
+        pthread_cond_signal(&c->main_cv);\n\
+        pthread_mutex_unlock(&c->lock);\n\
+        file_put(c, j.f);\n\
+    }\n\
+    return NULL;\n\
+}\n\
+\n\
+static int uring_run(char *const *paths, size_t n, const struct batch_opts *o,\n\
+                     struct batch_stats *st) {\n\
+    struct uring_ctx c = { .o = o, .n = n };\n\
+    struct ring ring;\n\
+    struct bfile *files = NULL, *cur = NULL;\n\
+    struct slab *slabs = NULL;\n\
+    struct iovec *iov = NULL;\n\
+    pthread_t *tids = NULL;\n\
+    unsigned started = 0, reads_inflight = 0, writes_inflight = 0;\n\
+    /* Slabs are numbered in write order: [s_done, s_sub) are being\n\
+     * written, s_fill is the one result lines are appended to.\n\
+     */\n\
+    unsigned long s_done = 0, s_sub = 0, s_fill = 0;\n\
+    size_t next_file = 0;\n\
+    int fixed, ret = 1, werr = 0;\n\
+\n\
+    if (ring_init(&ring, o->depth + BATCH_SLABS) < 0) {\n\
+        return 1;   /* not available: caller falls back */\n\
+    }\n\
+    files = calloc(n ? n : 1, sizeof(*files));\n\
+    slabs = calloc(BATCH_SLABS, sizeof(*slabs));\n\
+    iov = calloc(o->depth, sizeof(*iov));\n\
+    c.meta = calloc(o->depth, sizeof(*c.meta));\n\
+    c.jobs = calloc(o->depth, sizeof(*c.jobs));\n\
+    c.free_bufs = calloc(o->depth, sizeof(*c.free_bufs));\n\
+    tids = calloc(o->threads, sizeof(*tids));\n\
+    if (posix_memalign((void **) &c.bufs, 4096,\n\
+                       (size_t) o->depth * o->buf_size) != 0) {\n\
+        c.bufs = NULL;\n\
+    }\n\
+    if (!files || !slabs || !iov || !c.meta || !c.jobs || !c.free_bufs ||\n\
+            !tids || !c.bufs) {\n\
+        goto out;\n\
+    }\n\
+    for (unsigned i = 0; i < o->depth; i++) {\n\
+        iov[i].iov_base = c.bufs + (size_t) i * o->buf_size;\n\
+        iov[i].iov_len = o->buf_size;\n\
+        c.free_bufs[c.free_top++] = o->depth - 1 - i;\n\
+    }\n\
+    /* Registered buffers skip the per-read page pinning; older kernels\n\
+     * charge them to RLIMIT_MEMLOCK, so plain reads are the fallback.\n\
+     */\n\
+    fixed = syscall(__NR_io_uring_register, ring.fd,\n\
+                    IORING_REGISTER_BUFFERS, iov, o->depth) == 0;\n\
+\n\
+    pthread_mutex_init(&c.lock, NULL);\n\
+    pthread_cond_init(&c.work_cv, NULL);\n\
+    pthread_cond_init(&c.main_cv, NULL);\n\
+    for (unsigned i = 0; i < o->threads; i++) {\n\
+        if (pthread_create(&tids[i], NULL, uring_worker, &c) == 0) {\n\
+            started++;\n\
+        }\n\
+    }\n\
+    if (started == 0) {\n\
+        goto out_sync;\n\
+    }\n\
+    ret = 0;\n\
+\n\
+    for (;;) {\n\
+        /* Keep every idle buffer busy with the next chunk */\n\
+        for (;;) {\n\
+            struct io_uring_sqe *sqe;\n\
+            unsigned idx;\n\
+            size_t len;\n\
+\n\
+            while (cur == NULL && next_file < n) {\n\
+                struct bfile *f = &files[next_file];\n\
+                struct stat sb;\n\
+                f->path = paths[next_file++];\n\
+                atomic_init(&f->refs, 1);\n\
+                f->fd = open(f->path, O_RDONLY | O_CLOEXEC);\n\
+                if (f->fd < 0 || fstat(f->fd, &sb) < 0) {\n\
+                    fprintf(stderr, \"%s: %s\\n\", f->path, strerror(errno));\n\
+                    atomic_store(&f->failed, 1);\n\
+                    file_put(&c, f);\n\
+                } else if (!S_ISREG(sb.st_mode)) {\n\
+                    /* One error, not one per chunk of st_size */\n\
+                    fprintf(stderr, \"%s: %s\\n\", f->path, strerror(S_ISDIR(sb.st_mode)\n\
+                            ? EISDIR : EINVAL));\n\
+                    atomic_store(&f->failed, 1);\n\
+                    file_put(&c, f);\n\
+                } else if (sb.st_size == 0) {\n\
+                    file_put(&c, f);\n\
+                } else {\n\
+                    f->size = sb.st_size;\n\
+                    cur = f;\n\
+                }\n\
+            }\n\
+            if (cur == NULL) {\n\
+                break;\n\
+            }\n\
+            pthread_mutex_lock(&c.lock);\n\
+            if (c.free_top == 0) {\n\
+                pthread_mutex_unlock(&c.lock);\n\
+                break;\n\
+            }\n\
+            idx = c.free_bufs[--c.free_top];\n\
+            pthread_mutex_unlock(&c.lock);\n\
+\n\
+            sqe = ring_get_sqe(&ring);\n\
+            len = cur->size - cur->next < (off_t) o->buf_size\n\
+                  ? (size_t) (cur->size - cur->next) : o->buf_size;\n\
+            sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;\n\
+            sqe->fd = cur->fd;\n\
+            sqe->addr = (uintptr_t) iov[idx].iov_base;\n\
+            sqe->len = len;\n\
+            sqe->off = cur->next;\n\
+            sqe->buf_index = fixed ? idx : 0;\n\
+            sqe->user_data = (uint64_t) idx << 1 | TAG_READ;\n\
+            c.meta[idx].f = cur;\n\
+            c.meta[idx].idx = idx;\n\
+            c.meta[idx].off = cur->next;\n\
+            c.meta[idx].len = len;\n\
+            atomic_fetch_add(&cur->refs, 1);\n\
+            cur->next += len;\n\
+            reads_inflight++;\n\
+            if (cur->next >= cur->size) {\n\
+                struct bfile *f = cur;\n\
+                cur = NULL;\n\
+                file_put(&c, f);\n\
+            }\n\
+        }\n\
+\n\
+        /* Move finished result lines into slabs */\n\
+        pthread_mutex_lock(&c.lock);\n\
+        while (c.res_head != NULL) {\n\
+            struct line *l = c.res_head;\n\
+            struct slab *s = &slabs[s_fill % BATCH_SLABS];\n\
+            if (s->len + l->len > BATCH_SLAB_SIZE) {\n\
+                if (s_fill + 1 - s_done >= BATCH_SLABS) {\n\
+                    break;\n\
+                }\n\
+                s = &slabs[++s_fill % BATCH_SLABS];\n\
+            }\n\
+            memcpy(s->data + s->len, l->s, l->len);\n\
+            s->len += l->len;\n\
+            c.res_head = l->next;\n\
+            if (c.res_head == NULL) {\n\
+                c.res_tail = NULL;\n\
+            }\n\
+            free(l);\n\
+        }\n\
+        int all_done = c.completed == n && c.res_head == NULL;\n\
+        pthread_mutex_unlock(&c.lock);\n\
+\n\
+        /* Write every pending slab as one linked chain at offset -1:\n\
+         * the writes land in order at the file position and advance it,\n\
+         * so whoever shares out_fd appends after them, as with write().\n\
+         */\n\
+        if (writes_inflight == 0) {\n\
+            unsigned long end = s_fill;\n\
+            if (slabs[s_fill % BATCH_SLABS].len > 0 &&\n\
+                    s_fill + 1 - s_done < BATCH_SLABS) {\n\
+                end = s_fill + 1;\n\
+            }\n\
+            for (unsigned long q = s_sub; q < end; q++) {\n\
+                struct slab *s = &slabs[q % BATCH_SLABS];\n\
+                struct io_uring_sqe *sqe = ring_get_sqe(&ring);\n\
+                sqe->opcode = IORING_OP_WRITE;\n\
+                sqe->fd = o->out_fd;\n\
+                sqe->addr = (uintptr_t) s->data;\n\
+                sqe->len = s->len;\n\
+                sqe->off = (uint64_t) -1;\n\
+                sqe->flags = q + 1 < end ? IOSQE_IO_LINK : 0;\n\
+                sqe->user_data = (uint64_t) q << 1 | TAG_WRITE;\n\
+                writes_inflight++;\n\
+            }\n\
+            s_sub = end;\n\
+            if (s_fill < end) {\n\
+                s_fill = end;\n\
+            }\n\
+        }\n\
+\n\
+        if (reads_inflight + writes_inflight == 0) {\n\
+            if (all_done && slabs[s_fill % BATCH_SLABS].len == 0) {\n\
+                break;\n\
+            }\n\
+            pthread_mutex_lock(&c.lock);\n\
+            while (c.res_head == NULL && c.completed < n &&\n\
+                   !(c.free_top > 0 && (cur != NULL || next_file < n))) {\n\
+                pthread_cond_wait(&c.main_cv, &c.lock);\n\
+            }\n\
+            pthread_mutex_unlock(&c.lock);\n\
+            continue;\n\
+        }\n\
+\n\
+        if (ring_submit(&ring, 1) < 0) {\n\
+            fprintf(stderr, \"io_uring_enter: %s\\n\", strerror(errno));\n\
+            ret = -1;\n\
+            break;\n\
+        }\n\
+        unsigned head = *ring.cq_head;\n\
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);\n\
+        for (; head != tail; head++) {\n\
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];\n\
+            unsigned long id = cqe->user_data >> 1;\n\
+            if ((cqe->user_data & 1) == TAG_READ) {\n\
+                pthread_mutex_lock(&c.lock);\n\
+                c.meta[id].res = cqe->res;\n\
+                c.jobs[(c.jhead + c.jcount++) % o->depth] = c.meta[id];\n\
+                pthread_cond_signal(&c.work_cv);\n\
+                pthread_mutex_unlock(&c.lock);\n\
+                reads_inflight--;\n\
+            } else {\n\
+                /* A failed link cancels the rest of the chain; those\n\
+                 * slabs are finished synchronously, still in order.\n\
+                 */\n\
+                struct slab *s = &slabs[id % BATCH_SLABS];\n\
+                size_t done = cqe->res > 0 ? (size_t) cqe->res : 0;\n\
+                if (done < s->len &&\n\
+                        write_all(o->out_fd, s->data + done, s->len - done, -1) < 0) {\n\
+                    werr = errno;\n\
+                }\n\
+                if (--writes_inflight == 0) {\n\
+                    for (; s_done < s_sub; s_done++) {\n\
+                        slabs[s_done % BATCH_SLABS].len = 0;\n\
+                    }\n\
+                }\n\
+            }\n\
+        }\n\
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);\n\
+    }\n\
+\n\
+    pthread_mutex_lock(&c.lock);\n\
+    c.stop = 1;\n\
+    pthread_cond_broadcast(&c.work_cv);\n\
+    pthread_mutex_unlock(&c.lock);\n\
+    for (unsigned i = 0; i < started; i++) {\n\
+        pthread_join(tids[i], NULL);\n\
+    }\n\
+    if (werr != 0) {\n\
+        fprintf(stderr, \"write: %s\\n\", strerror(werr));\n\
+        ret = -1;\n\
+    }\n\
+    if (c.failed > 0) {\n\
+        ret = -1;\n\
+    }\n\
+    stats_fill(st, n, c.failed, c.bytes);\n\
+    if (st != NULL) {\n\
+        st->used_uring = 1;\n\
+        st->used_fixed_bufs = fixed;\n\
+    }\n\
+\n\
+out_sync:\n\
+    pthread_cond_destroy(&c.main_cv);\n\
+    pthread_cond_destroy(&c.work_cv);\n\
+    pthread_mutex_destroy(&c.lock);\n\
+out:\n\
+    ring_exit(&ring);\n\
+    free(c.bufs);\n\
+    free(tids);\n\
+    free(c.free_bufs);\n\
+    free(c.jobs);\n\
+    free(c.meta);\n\
+    free(iov);\n\
+    free(slabs);\n\
+    free(files);\n\
+    return ret;\n\
+}\n\
+\n\
+#endif\n\
+\n\
+int batch_run(char *const *paths, size_t n, const struct batch_opts *o,\n\
+              struct batch_stats *st) {\n\
+    struct batch_opts def = *o;\n\
+    if (def.depth == 0) {\n\
+        def.depth = 64;\n\
+    }\n\
+    if (def.threads == 0) {\n\
+        def.threads = 4;\n\
+    }\n\
+    if (def.buf_size == 0) {\n\
+        def.buf_size = 64 * 1024;\n\
+    }\n\
+    if (st != NULL) {\n\
+        memset(st, 0, sizeof(*st));\n\
+    }\n\
+#ifdef BATCH_HAVE_URING\n\
+    if (!def.force_pread) {\n\
+        int ret = uring_run(paths, n, &def, st);\n\
+        if (ret <= 0) {\n\
+            return ret;\n\
+        }\n\
+    }\n\
+#endif\n\
+    return pread_run(paths, n, &def, st);\n\
+}\n";
+
+
+/* src/Project_app.c */
+static const char URING_APP_C[] = "\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <unistd.h>\n\
+#include <fcntl.h>\n\
+\n\
+#include \"@PROJECT@.h\"\n\
+\n\
+static void usage(const char *argv0) {\n\
+    fprintf(stderr,\n\
+            \"usage: %s [-d depth] [-t threads] [-b bufsize] [-o out] [-P] FILE...\\n\"\n\
+            \"  -d  reads kept in flight (default 64)\\n\"\n\
+            \"  -t  worker threads (default 4)\\n\"\n\
+            \"  -b  read buffer size in bytes (default 65536)\\n\"\n\
+            \"  -o  write results to out instead of stdout\\n\"\n\
+            \"  -P  force the pread fallback\\n\", argv0);\n\
+}\n\
+\n\
+int main(int argc, char *argv[]) {\n\
+    struct batch_opts o = { .out_fd = STDOUT_FILENO };\n\
+    struct batch_stats st;\n\
+    int opt, ret;\n\
+\n\
+    while ((opt = getopt(argc, argv, \"d:t:b:o:Ph\")) != -1) {\n\
+        switch (opt) {\n\
+            case 'd':\n\
+                o.depth = strtoul(optarg, NULL, 10);\n\
+                break;\n\
+            case 't':\n\
+                o.threads = strtoul(optarg, NULL, 10);\n\
+                break;\n\
+            case 'b':\n\
+                o.buf_size = strtoul(optarg, NULL, 10);\n\
+                break;\n\
+            case 'o':\n\
+                o.out_fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);\n\
+                if (o.out_fd < 0) {\n\
+                    perror(optarg);\n\
+                    return 1;\n\
+                }\n\
+                break;\n\
+            case 'P':\n\
+                o.force_pread = 1;\n\
+                break;\n\
+            default:\n\
+                usage(argv[0]);\n\
+                return opt == 'h' ? 0 : 1;\n\
+        }\n\
+    }\n\
+    if (optind == argc) {\n\
+        usage(argv[0]);\n\
+        return 1;\n\
+    }\n\
+\n\
+    ret = batch_run(argv + optind, argc - optind, &o, &st);\n\
+    fprintf(stderr, \"%zu files, %zu failed, %zu bytes via %s%s\\n\",\n\
+            st.files, st.failed, st.bytes,\n\
+            st.used_uring ? \"io_uring\" : \"pread\",\n\
+            st.used_fixed_bufs ? \" (registered buffers)\" : \"\");\n\
+    return ret == 0 ? 0 : 1;\n\
+}\n";
+
+
+/* bench/Project_bench.c */
+static const char URING_BENCH_C[] = "\
+#define _GNU_SOURCE\n\
+#include <fcntl.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <unistd.h>\n\
+\n\
+#include \"@PROJECT@.h\"\n\
+#include \"@PROJECT@_benchenv.h\"\n\
+\n\
+/* Compares the batch engine against a naive open/read/close loop on\n\
+ * many small files. The files stay in the page cache after the first\n\
+ * pass, so this measures submission overhead rather than the disk.\n\
+ * One operation is a pass over every file.\n\
+ */\n\
+\n\
+struct fileset {\n\
+    char **paths;\n\
+    size_t n;\n\
+    int out_fd;\n\
+    const struct benchenv *env;\n\
+};\n\
+\n\
+static void naive_pass(void *arg, uint64_t iters) {\n\
+    struct fileset *fs = arg;\n\
+    char buf[65536], line[4352];\n\
+    for (uint64_t it = 0; it < iters; it++) {\n\
+        for (size_t i = 0; i < fs->n; i++) {\n\
+            struct batch_result r = {0};\n\
+            size_t off = 0;\n\
+            ssize_t got;\n\
+            int fd = open(fs->paths[i], O_RDONLY);\n\
+            if (fd < 0) {\n\
+                continue;\n\
+            }\n\
+            while ((got = read(fd, buf, sizeof(buf))) > 0) {\n\
+                batch_process_chunk(&r, off, buf, got);\n\
+                off += got;\n\
+            }\n\
+            close(fd);\n\
+            int len = batch_format_result(line, sizeof(line), fs->paths[i], &r);\n\
+            if (len > 0 && write(fs->out_fd, line, len) < 0) {\n\
+                return;\n\
+            }\n\
+        }\n\
+    }\n\
+}\n\
+\n\
+/* cpus[0] belongs to the measuring thread; workers spread over the rest */\n\
+static void pin_worker(void *arg, unsigned i) {\n\
+    const struct benchenv *env = arg;\n\
+    benchenv_pin_thread(env, env->ncpus > 1 ? 1 + i % (env->ncpus - 1) : 0);\n\
+}\n\
+\n\
+static void batch_pass(struct fileset *fs, uint64_t iters, int force_pread) {\n\
+    struct batch_opts o = { .out_fd = fs->out_fd, .force_pread = force_pread,\n\
+                            .thread_start = pin_worker, .thread_arg = (void *) fs->env };\n\
+    for (uint64_t it = 0; it < iters; it++) {\n\
+        batch_run(fs->paths, fs->n, &o, NULL);\n\
+    }\n\
+}\n\
+\n\
+static void uring_pass(void *arg, uint64_t iters) {\n\
+    batch_pass(arg, iters, 0);\n\
+}\n\
+\n\
+static void pread_pass(void *arg, uint64_t iters) {\n\
+    batch_pass(arg, iters, 1);\n\
+}\n\
+\n\
+int main(int argc, char *argv[]) {\n\
+    size_t nfiles = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;\n\
+    size_t fsize = argc > 2 ? strtoul(argv[2], NULL, 10) : 4096;\n\
+    char dir[] = \"/tmp/@PROJECT@_bench.XXXXXX\";\n\
+    char *data = malloc(fsize);\n\
+    struct benchenv env;\n\
+    struct fileset fs = { calloc(nfiles, sizeof(char *)), nfiles,\n\
+                          open(\"/dev/null\", O_WRONLY), &env };\n\
+    struct bench_result r;\n\
+    struct batch_stats st;\n\
+    struct batch_opts probe = { .out_fd = fs.out_fd };\n\
+    char name[64];\n\
+    int ret = 0;\n\
+\n\
+    if (benchenv_setup(&env) != 0) {\n\
+        return 1;\n\
+    }\n\
+    if (fs.paths == NULL || data == NULL || mkdtemp(dir) == NULL || fs.out_fd < 0) {\n\
+        perror(\"setup\");\n\
+        return 1;\n\
+    }\n\
+    for (size_t i = 0; i < fsize; i++) {\n\
+        data[i] = i % 64 == 63 ? '\\n' : 'a' + i % 26;\n\
+    }\n\
+    for (size_t i = 0; i < nfiles; i++) {\n\
+        fs.paths[i] = malloc(sizeof(dir) + 16);\n\
+        sprintf(fs.paths[i], \"%s/f%06zu\", dir, i);\n\
+        int fd = open(fs.paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);\n\
+        if (fd < 0 || write(fd, data, fsize) != (ssize_t) fsize) {\n\
+            perror(fs.paths[i]);\n\
+            return 1;\n\
+        }\n\
+        close(fd);\n\
+    }\n\
+\n\
+    printf(\"%zu files x %zu bytes per pass\\n\", nfiles, fsize);\n\
+    batch_run(fs.paths, 1, &probe, &st);\n\
+    snprintf(name, sizeof(name), \"naive_read_loop_%zux%zu\", nfiles, fsize);\n\
+    ret |= bench_run(&env, name, naive_pass, &fs, &r);\n\
+    snprintf(name, sizeof(name), \"batch_%s_%zux%zu\",\n\
+             st.used_uring ? \"uring\" : \"pread\", nfiles, fsize);\n\
+    ret |= bench_run(&env, name, uring_pass, &fs, &r);\n\
+    if (st.used_uring) {\n\
+        snprintf(name, sizeof(name), \"batch_pread_%zux%zu\", nfiles, fsize);\n\
+        ret |= bench_run(&env, name, pread_pass, &fs, &r);\n\
+    }\n\
+\n\
+    for (size_t i = 0; i < nfiles; i++) {\n\
+        unlink(fs.paths[i]);\n\
+        free(fs.paths[i]);\n\
+    }\n\
+    rmdir(dir);\n\
+    free(fs.paths);\n\
+    free(data);\n\
+    return ret != 0;\n\
+}\n";
+
+
+/* test/Project_test.c, run by make check */
+static const char URING_TEST_C[] = "\
+#define _GNU_SOURCE\n\
+#include <fcntl.h>\n\
+#include <stdio.h>\n\
+#include <stdlib.h>\n\
+#include <string.h>\n\
+#include <unistd.h>\n\
+\n\
+#include \"@PROJECT@.h\"\n\
+\n\
+/* Output written by batch_run must sit where plain write() calls\n\
+ * would have put it: after what was already in out_fd and before\n\
+ * anything written to the same fd afterwards. Each engine runs on the\n\
+ * same files between a head and a tail line; the results, compared\n\
+ * as sorted lines, must match the pread fallback.\n\
+ */\n\
+\n\
+#define NFILES 200\n\
+\n\
+static int failures;\n\
+\n\
+static void check(int ok, const char *what) {\n\
+    if (!ok) {\n\
+        fprintf(stderr, \"FAIL: %s\\n\", what);\n\
+        failures++;\n\
+    }\n\
+}\n\
+\n\
+static int cmp_line(const void *a, const void *b) {\n\
+    return strcmp(*(char *const *) a, *(char *const *) b);\n\
+}\n\
+\n\
+/* Runs one engine into a fresh file; returns its contents */\n\
+static char *run(char **paths, const char *dir, int force_pread, int *used_uring) {\n\
+    struct batch_opts o = { .force_pread = force_pread };\n\
+    struct batch_stats st;\n\
+    char out[4096], *buf;\n\
+    off_t size;\n\
+\n\
+    snprintf(out, sizeof(out), \"%s/out\", dir);\n\
+    if ((o.out_fd = open(out, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 ||\n\
+            write(o.out_fd, \"HEAD\\n\", 5) != 5) {\n\
+        return NULL;\n\
+    }\n\
+    check(batch_run(paths, NFILES, &o, &st) == 0, \"batch_run\");\n\
+    check(st.files == NFILES && st.failed == 0, \"batch_stats\");\n\
+    *used_uring = st.used_uring;\n\
+    check(write(o.out_fd, \"TAIL\\n\", 5) == 5, \"write after the batch\");\n\
+\n\
+    size = lseek(o.out_fd, 0, SEEK_END);\n\
+    if (size < 0 || (buf = calloc(1, (size_t) size + 1)) == NULL) {\n\
+        close(o.out_fd);\n\
+        return NULL;\n\
+    }\n\
+    if (pread(o.out_fd, buf, (size_t) size, 0) != size) {\n\
+        buf[0] = '\\0';\n\
+    }\n\
+    close(o.out_fd);\n\
+    unlink(out);\n\
+    return buf;\n\
+}\n\
+\n\
+/* Checks the head and tail lines and sorts the result lines between */\n\
+static char **lines(char *buf, size_t *n) {\n\
+    char **v = calloc(NFILES + 3, sizeof(*v));\n\
+    size_t len = strlen(buf);\n\
+    *n = 0;\n\
+    check(strncmp(buf, \"HEAD\\n\", 5) == 0, \"output starts with the head line\");\n\
+    check(len >= 10 && strcmp(buf + len - 5, \"TAIL\\n\") == 0,\n\
+          \"output ends with the tail line\");\n\
+    if (v == NULL || len < 10) {\n\
+        return v;\n\
+    }\n\
+    buf[len - 5] = '\\0';\n\
+    for (char *l = strtok(buf + 5, \"\\n\"); l != NULL && *n < NFILES + 2; l = strtok(NULL, \"\\n\")) {\n\
+        v[(*n)++] = l;\n\
+    }\n\
+    qsort(v, *n, sizeof(*v), cmp_line);\n\
+    return v;\n\
+}\n\
+\n\
+int main(void) {\n\
+    char dir[] = \"/tmp/@PROJECT@_test.XXXXXX\", *paths[NFILES];\n\
+    char *engine, *fallback, **a, **b;\n\
+    size_t na, nb;\n\
+    int uring, unused;\n\
+\n\
+    if (mkdtemp(dir) == NULL) {\n\
+        perror(\"mkdtemp\");\n\
+        return 1;\n\
+    }\n\
+    for (int i = 0; i < NFILES; i++) {\n\
+        char path[4096];\n\
+        FILE *fp;\n\
+        snprintf(path, sizeof(path), \"%s/f%03d\", dir, i);\n\
+        if ((fp = fopen(path, \"w\")) == NULL) {\n\
+            perror(path);\n\
+            return 1;\n\
+        }\n\
+        for (int j = 0; j < i * 37; j++) {\n\
+            fprintf(fp, \"line %d of file %d\\n\", j, i);\n\
+        }\n\
+        fclose(fp);\n\
+        paths[i] = strdup(path);\n\
+    }\n\
+\n\
+    engine = run(paths, dir, 0, &uring);\n\
+    fallback = run(paths, dir, 1, &unused);\n\
+    if (engine == NULL || fallback == NULL) {\n\
+        perror(\"output\");\n\
+        return 1;\n\
+    }\n\
+    a = lines(engine, &na);\n\
+    b = lines(fallback, &nb);\n\
+    check(na == NFILES && nb == NFILES, \"one result line per file\");\n\
+    for (size_t i = 0; i < na && i < nb; i++) {\n\
+        if (strcmp(a[i], b[i]) != 0) {\n\
+            check(0, \"results match the pread fallback\");\n\
+            break;\n\
+        }\n\
+    }\n\
+\n\
+    for (int i = 0; i < NFILES; i++) {\n\
+        unlink(paths[i]);\n\
+        free(paths[i]);\n\
+    }\n\
+    rmdir(dir);\n\
+    free(a);\n\
+    free(b);\n\
+    free(engine);\n\
+    free(fallback);\n\
+    printf(\"%s: %s (engine: %s)\\n\", failures ? \"FAIL\" : \"ok\", \"batch output position\",\n\
+           uring ? \"io_uring\" : \"pread\");\n\
+    return failures != 0;\n\
+}\n";
+
+
+/* Appended to the generated Makefile */
+static const char URING_MAKE[] = "\
+\n\
+\n\
+# uring-batch archetype: io_uring engine in lib, thin driver in src\n\
+BATCH_CFLAGS=-O2 -g -Wall -pthread -Ilib\n\
+BATCH_SRC=lib/@PROJECT@.c\n\
+BATCH_DEPS=$(BATCH_SRC) lib/@PROJECT@.h\n\
+\n\
+build/@PROJECT@_app: src/@PROJECT@_app.c $(BATCH_DEPS)\n\
+	@mkdir -p build\n\
+	$(CC) -o $@ src/@PROJECT@_app.c $(BATCH_SRC) $(COMPONENT_SRC) $(BATCH_CFLAGS) $(COMPONENT_CFLAGS) $(LIBS)\n\
+\n\
+build/@PROJECT@_test: test/@PROJECT@_test.c $(BATCH_DEPS)\n\
+	@mkdir -p build\n\
+	$(CC) -o $@ test/@PROJECT@_test.c $(BATCH_SRC) $(COMPONENT_SRC) $(BATCH_CFLAGS) $(COMPONENT_CFLAGS) $(LIBS)\n\
+\n\
+.PHONY: batch check\n\
+\n\
+batch: build/@PROJECT@_app\n\
+\n\
+check: build/@PROJECT@_test\n\
+	./build/@PROJECT@_test\n";
+
+
+#endif
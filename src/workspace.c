@@ -0,0 +1,361 @@
+/*
+ * Name-to-path index for sharded workspaces
+ *
+ *      projc --shard-depth N places projects under hash-prefix
+ *      directories; the index in the workspace root lets other
+ *      commands find a project without walking the shards. It is an
+ *      append-only list of "name<TAB>path" lines: appends happen
+ *      under a lock with one write each, so readers see either the
+ *      old or the new contents. A line torn by a crash is never
+ *      newline-terminated; readers skip it and the next append cuts
+ *      it off. Later lines win, and the file is rewritten without
+ *      the superseded ones under the same lock once they pile up.
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "workspace.h"
+
+#define WS_PATH_MAX 4096
+
+#if (defined (_WIN32) || defined (_WIN64))
+
+int ws_index_add(const char *root, const char *name, const char *path) {
+    (void) root;
+    (void) name;
+    (void) path;
+    printf("The workspace index is not supported on Windows.\n");
+    return 0;
+}
+
+int ws_index_compact(const char *root, int always) {
+    (void) root;
+    (void) always;
+    return 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Cuts the file back to just after its last newline; 0 on failure */
+static int ws_truncate_torn(int fd, off_t size) {
+    char buf[4096];
+    off_t pos = size, keep = 0;
+
+    while (pos > 0 && keep == 0) {
+        size_t chunk = pos > (off_t) sizeof(buf) ? sizeof(buf) : (size_t) pos;
+        if (pread(fd, buf, chunk, pos - (off_t) chunk) != (ssize_t) chunk) {
+            return 0;
+        }
+        pos -= (off_t) chunk;
+        for (size_t i = chunk; i > 0 && keep == 0; i--) {
+            if (buf[i - 1] == '\n') {
+                keep = pos + (off_t) i;
+            }
+        }
+    }
+    return ftruncate(fd, keep) == 0;
+}
+
+
+/* Takes the index lock of root and fills in the index path; the
+ * lock fd, or -1
+ */
+static int ws_lock(const char *root, char *file) {
+    char lock[WS_PATH_MAX];
+    int lfd;
+
+    if (snprintf(file, WS_PATH_MAX, "%s/%s", root, WS_INDEX) >= WS_PATH_MAX ||
+            snprintf(lock, sizeof(lock), "%s.lock", file) >= (int) sizeof(lock)) {
+        return -1;
+    }
+    if ((lfd = open(lock, O_RDWR | O_CREAT, 0644)) < 0) {
+        return -1;
+    }
+    if (flock(lfd, LOCK_EX) != 0) {
+        close(lfd);
+        return -1;
+    }
+    return lfd;
+}
+
+
+static void ws_unlock(int lfd) {
+    flock(lfd, LOCK_UN);
+    close(lfd);
+}
+
+
+/* Writes the live entries to a temporary file and renames it over the
+ * index; the lock is held, so no append can be lost in between
+ */
+static int ws_compact_locked(const char *root, const char *file, int always) {
+    char tmp[WS_PATH_MAX];
+    struct ws_index idx;
+    FILE *fp;
+    int ret = 1;
+
+    if (!ws_index_load(root, &idx)) {
+        return 1;   /* no index, nothing to do */
+    }
+    if (idx.lines - idx.n == 0 || (!always && idx.lines - idx.n <= idx.n)) {
+        ws_index_free(&idx);
+        return 1;
+    }
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int) sizeof(tmp) ||
+            (fp = fopen(tmp, "w")) == NULL) {
+        ws_index_free(&idx);
+        return 0;
+    }
+    for (size_t i = 0; i < idx.n; i++) {
+        fprintf(fp, "%s\t%s\n", idx.entries[i].name, idx.entries[i].path);
+    }
+    if (fflush(fp) != 0 || fdatasync(fileno(fp)) != 0) {
+        ret = 0;
+    }
+    if (fclose(fp) != 0 || !ret || rename(tmp, file) != 0) {
+        unlink(tmp);
+        ret = 0;
+    }
+    ws_index_free(&idx);
+    return ret;
+}
+
+
+int ws_index_compact(const char *root, int always) {
+    char file[WS_PATH_MAX];
+    int lfd, ret;
+
+    if ((lfd = ws_lock(root, file)) < 0) {
+        return 0;
+    }
+    ret = ws_compact_locked(root, file, always);
+    ws_unlock(lfd);
+    return ret;
+}
+
+
+int ws_index_add(const char *root, const char *name, const char *path) {
+    char file[WS_PATH_MAX], line[WS_PATH_MAX];
+    int lfd, fd, len, ret = 0;
+    struct stat st;
+
+    if (strpbrk(name, "\t\n") != NULL || strpbrk(path, "\t\n") != NULL ||
+            (lfd = ws_lock(root, file)) < 0) {
+        return 0;
+    }
+    if ((fd = open(file, O_RDWR | O_APPEND | O_CREAT, 0644)) >= 0) {
+        char last = '\n';
+        /* Drop a line torn by a crashed writer; the lock is held */
+        if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+                pread(fd, &last, 1, st.st_size - 1) == 1 && last != '\n' &&
+                !ws_truncate_torn(fd, st.st_size)) {
+            last = '\0';
+        }
+        len = snprintf(line, sizeof(line), "%s\t%s\n", name, path);
+        if (last != '\0' && len < (int) sizeof(line) && write(fd, line, (size_t) len) == len &&
+                fdatasync(fd) == 0) {
+            ret = 1;
+        }
+        close(fd);
+    }
+    /* A failed compaction leaves a valid, only longer, index */
+    if (ret) {
+        ws_compact_locked(root, file, 0);
+    }
+    ws_unlock(lfd);
+    return ret;
+}
+
+#endif
+
+
+/* Same name: file order, so the last line of a run is the newest */
+static int by_name(const void *a, const void *b) {
+    const struct ws_entry *x = a, *y = b;
+    int c = strcmp(x->name, y->name);
+    if (c == 0) {
+        c = (x->name > y->name) - (x->name < y->name);
+    }
+    return c;
+}
+
+
+int ws_index_load(const char *root, struct ws_index *idx) {
+    char file[WS_PATH_MAX];
+    size_t size = 0, cap = 0, got, n = 0;
+    char *p, *end;
+    FILE *fp;
+
+    idx->entries = NULL;
+    idx->n = 0;
+    idx->lines = 0;
+    idx->buf = NULL;
+    if (snprintf(file, sizeof(file), "%s/%s", root, WS_INDEX) >= (int) sizeof(file) ||
+            (fp = fopen(file, "rb")) == NULL) {
+        return 0;
+    }
+    do {
+        if (size == cap) {
+            char *buf = realloc(idx->buf, (cap = cap ? cap * 2 : 1 << 16) + 1);
+            if (buf == NULL) {
+                fclose(fp);
+                ws_index_free(idx);
+                return 0;
+            }
+            idx->buf = buf;
+        }
+        got = fread(idx->buf + size, 1, cap - size, fp);
+        size += got;
+    } while (got > 0);
+    fclose(fp);
+    if (idx->buf == NULL) {
+        return 0;
+    }
+    idx->buf[size] = '\0';
+
+    for (p = idx->buf; (p = strchr(p, '\n')) != NULL; p++) {
+        n++;
+    }
+    if ((idx->entries = malloc((n + 1) * sizeof(*idx->entries))) == NULL) {
+        ws_index_free(idx);
+        return 0;
+    }
+    /* Only newline-terminated lines count; the tail may be torn */
+    for (p = idx->buf; (end = strchr(p, '\n')) != NULL; p = end + 1) {
+        char *tab = memchr(p, '\t', (size_t) (end - p));
+        *end = '\0';
+        if (tab == NULL || tab == p || tab + 1 == end) {
+            continue;
+        }
+        *tab = '\0';
+        idx->entries[idx->n].name = p;
+        idx->entries[idx->n++].path = tab + 1;
+    }
+    idx->lines = idx->n;
+    qsort(idx->entries, idx->n, sizeof(*idx->entries), by_name);
+    n = 0;
+    for (size_t i = 0; i < idx->n; i++) {
+        if (i + 1 < idx->n && strcmp(idx->entries[i].name, idx->entries[i + 1].name) == 0) {
+            continue;
+        }
+        idx->entries[n++] = idx->entries[i];
+    }
+    idx->n = n;
+    return 1;
+}
+
+
+const struct ws_entry *ws_index_find(const struct ws_index *idx, const char *name) {
+    size_t lo = 0, hi = idx->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcmp(idx->entries[mid].name, name);
+        if (c == 0) {
+            return &idx->entries[mid];
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+
+void ws_index_free(struct ws_index *idx) {
+    free(idx->entries);
+    free(idx->buf);
+    idx->entries = NULL;
+    idx->buf = NULL;
+    idx->n = 0;
+    idx->lines = 0;
+}
+
+
+/* Splits [-C DIR] [NAME] out of argv; 0 on anything else */
+static int ws_args(int argc, char *argv[], const char **root, const char **name) {
+    *root = ".";
+    *name = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            *root = argv[++i];
+        } else if (argv[i][0] != '-' && *name == NULL) {
+            *name = argv[i];
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+int locate_main(int argc, char *argv[]) {
+    const char *root, *name;
+    const struct ws_entry *e;
+    struct ws_index idx;
+    int found;
+
+    if (!ws_args(argc, argv, &root, &name) || name == NULL) {
+        printf("usage: projc locate NAME [-C DIR]\n");
+        return 1;
+    }
+    if (!ws_index_load(root, &idx)) {
+        printf("No %s in %s\n", WS_INDEX, root);
+        return 1;
+    }
+    if ((found = (e = ws_index_find(&idx, name)) != NULL)) {
+        printf("%s/%s\n", root, e->path);
+    }
+    ws_index_free(&idx);
+    return !found;
+}
+
+
+int list_main(int argc, char *argv[]) {
+    const char *root, *name;
+    struct ws_index idx;
+
+    if (!ws_args(argc, argv, &root, &name) || name != NULL) {
+        printf("usage: projc list [-C DIR]\n");
+        return 1;
+    }
+    /* Listing reads every line anyway; drop the superseded ones */
+    ws_index_compact(root, 1);
+    if (!ws_index_load(root, &idx)) {
+        printf("No %s in %s\n", WS_INDEX, root);
+        return 1;
+    }
+    for (size_t i = 0; i < idx.n; i++) {
+        printf("%s\t%s/%s\n", idx.entries[i].name, root, idx.entries[i].path);
+    }
+    ws_index_free(&idx);
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Name-to-path index for sharded workspaces
+ *
+ *   Copyright (C) 2017 John Andersen
+ *      Email: johnandersen185@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ */
+
+#ifndef PROJC_WORKSPACE_H
+#define PROJC_WORKSPACE_H
+
+#include <stddef.h>
+
+/* Index file kept in the workspace root */
+#define WS_INDEX ".projc-index"
+
+struct ws_entry {
+    const char *name;
+    const char *path;       /* relative to the workspace root, '/' separated */
+};
+
+struct ws_index {
+    struct ws_entry *entries;   /* sorted by name, one per name */
+    size_t n;
+    size_t lines;               /* lines read, superseded ones included */
+    char *buf;
+};
+
+/* Appends name -> path to root's index; 0 on failure */
+int ws_index_add(const char *root, const char *name, const char *path);
+
+/* Rewrites root's index with one line per name when any line is
+ * superseded (always) or when those outnumber the live ones; 0 on
+ * failure
+ */
+int ws_index_compact(const char *root, int always);
+
+/* Loads root's index; 0 when there is none */
+int ws_index_load(const char *root, struct ws_index *idx);
+
+const struct ws_entry *ws_index_find(const struct ws_index *idx, const char *name);
+
+void ws_index_free(struct ws_index *idx);
+
+/* projc locate NAME [-C DIR]
+ *      Prints the directory of an indexed project
+ * projc list [-C DIR]
+ *      Prints every indexed project and its directory
+ */
+int locate_main(int argc, char *argv[]);
+int list_main(int argc, char *argv[]);
+
+#endif